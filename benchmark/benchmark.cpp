@@ -1,8 +1,12 @@
 #include <chrono>
 #include <cstdint>
+#include <filesystem>
 #include <iostream>
 #include <string_view>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 #include <ec-cpp/ec-cpp.hpp>
 
 extern "C" {
@@ -107,7 +111,316 @@ void Cpp_Measures() {
   }
 }
 
+void Cpp_MeasureBatch() {
+  constexpr size_t kValidators = 1000ull;
+  constexpr size_t kPayloads = 32ull;
+  constexpr size_t kPayloadSize = 1000ull * 1000ull;
+
+  auto encoder = ec_cpp::resultGetValue(ec_cpp::create(kValidators));
+  std::vector<std::vector<ec_cpp::ReedSolomon<ec_cpp::PolyEncoder_f2e16>::Shard>>
+      batch;
+  for (size_t p = 0ull; p < kPayloads; ++p) {
+    std::vector<uint8_t> payload(kPayloadSize);
+    for (size_t i = 0ull; i < payload.size(); ++i)
+      payload[i] = uint8_t(i * 7 + p);
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+    /// the same third of the validators is unreachable for every candidate
+    for (size_t i = 0ull; i < kValidators; i += 3ull)
+      shards[i].clear();
+    batch.push_back(std::move(shards));
+  }
+
+  std::cout << "~~~ [ Batch reconstruct: " << kPayloads << " x "
+            << kPayloadSize << " bytes, " << kValidators
+            << " validators ] ~~~" << std::endl;
+  {
+    TicToc m;
+    for (const auto &shards : batch)
+      encoder.reconstruct(shards);
+    std::cout << "reconstruct loop: " << m.toc().count() / 1000 << " ms"
+              << std::endl;
+  }
+  {
+    TicToc m;
+    encoder.reconstructBatch(batch);
+    std::cout << "reconstructBatch: " << m.toc().count() / 1000 << " ms"
+              << std::endl;
+  }
+}
+
+void Cpp_MeasureDecode() {
+  constexpr size_t kPayloadSize = 4ull * 1000ull * 1000ull;
+  std::vector<uint8_t> payload(kPayloadSize);
+  for (size_t i = 0ull; i < payload.size(); ++i)
+    payload[i] = uint8_t(i * 7);
+
+  std::cout << "~~~ [ Decode: " << kPayloadSize
+            << " bytes, a third of the shards missing ] ~~~" << std::endl;
+  for (const size_t validators : {1000ull, 4000ull, 16000ull, 65000ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(validators));
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+    for (size_t i = 0ull; i < validators; i += 3ull)
+      shards[i].clear();
+
+    TicToc m;
+    encoder.reconstruct(shards);
+    std::cout << "n = " << encoder.n() << ", k = " << encoder.k() << ": "
+              << m.toc().count() / 1000 << " ms" << std::endl;
+  }
+}
+
+void Cpp_MeasureEngines() {
+  constexpr size_t kPayloadSize = 4ull * 1000ull * 1000ull;
+  std::vector<uint8_t> payload(kPayloadSize);
+  for (size_t i = 0ull; i < payload.size(); ++i)
+    payload[i] = uint8_t(i * 7);
+
+  std::cout << "~~~ [ Engines: " << kPayloadSize << " bytes ] ~~~"
+            << std::endl;
+  for (const size_t validators : {100ull, 1000ull}) {
+    for (const auto engine : {ec_cpp::TransformEngine::kLogExp,
+                              ec_cpp::TransformEngine::kBitsliced}) {
+      auto encoder = ec_cpp::resultGetValue(ec_cpp::create(validators));
+      encoder.selectEngine(engine);
+      const auto *name =
+          engine == ec_cpp::TransformEngine::kLogExp ? "log/exp" : "bitsliced";
+
+      TicToc e;
+      auto shards = ec_cpp::resultGetValue(
+          encoder.encode({payload.data(), payload.size()}));
+      const auto encode_ms = e.toc().count() / 1000;
+      for (size_t i = 0ull; i < validators; i += 3ull)
+        shards[i].clear();
+
+      TicToc d;
+      encoder.reconstruct(shards);
+      std::cout << "n = " << validators << ", " << name
+                << ": encode " << encode_ms << " ms, reconstruct "
+                << d.toc().count() / 1000 << " ms" << std::endl;
+    }
+  }
+}
+
+template <typename Encoder>
+void Cpp_MeasureDescriptor(const char *name, Encoder encoder,
+                           size_t validators,
+                           std::vector<uint8_t> &payload) {
+  TicToc e;
+  auto shards = ec_cpp::resultGetValue(
+      encoder.encode({payload.data(), payload.size()}));
+  const auto encode_ms = e.toc().count() / 1000;
+  for (size_t i = 0ull; i < validators; i += 3ull)
+    shards[i].clear();
+
+  TicToc d;
+  encoder.reconstruct(shards);
+  std::cout << "n = " << validators << ", " << name << ": encode "
+            << encode_ms << " ms, reconstruct " << d.toc().count() / 1000
+            << " ms" << std::endl;
+}
+
+void Cpp_MeasureDescriptors() {
+  constexpr size_t kPayloadSize = 4ull * 1000ull * 1000ull;
+  std::vector<uint8_t> payload(kPayloadSize);
+  for (size_t i = 0ull; i < payload.size(); ++i)
+    payload[i] = uint8_t(i * 7);
+
+  std::cout << "~~~ [ Descriptors: " << kPayloadSize << " bytes ] ~~~"
+            << std::endl;
+  for (const size_t validators : {100ull, 256ull, 1000ull}) {
+    Cpp_MeasureDescriptor("log/exp tables",
+                          ec_cpp::resultGetValue(ec_cpp::create(validators)),
+                          validators, payload);
+    Cpp_MeasureDescriptor(
+        "clmul", ec_cpp::resultGetValue(ec_cpp::createClmul(validators)),
+        validators, payload);
+    if (validators <= 256ull)
+      Cpp_MeasureDescriptor(
+          "GF(2^8)", ec_cpp::resultGetValue(ec_cpp::createF2e8(validators)),
+          validators, payload);
+  }
+}
+
+void Cpp_MeasureFormalDerivative() {
+  constexpr size_t kRepeats = 100ull;
+  std::cout << "~~~ [ Formal derivative: " << kRepeats << " cycles ] ~~~"
+            << std::endl;
+  for (const size_t size : {1024ull, 65536ull}) {
+    std::vector<ec_cpp::Additive<ec_cpp::f2e16_Descriptor>> data(size);
+    for (size_t i = 0ull; i < size; ++i)
+      data[i].point_0 = uint16_t(i * 7);
+
+    TicToc s;
+    for (size_t r = 0ull; r < kRepeats; ++r)
+      ec_cpp::formalDerivativeScalar(data.data(), size, size);
+    const auto scalar_us = s.toc().count();
+    TicToc v;
+    for (size_t r = 0ull; r < kRepeats; ++r)
+      ec_cpp::formalDerivative(data.data(), size, size);
+    std::cout << "size = " << size << ": scalar " << scalar_us
+              << " us, blocked " << v.toc().count() << " us" << std::endl;
+  }
+}
+
+void Cpp_MeasureFixedShapes() {
+  using Descriptor = ec_cpp::f2e16_Descriptor;
+  const Descriptor descriptor;
+  const ec_cpp::PolyEncoder_f2e16 poly_enc(descriptor);
+  constexpr size_t kSymbols = 1ull << 20ull;
+  std::cout << "~~~ [ Fixed shapes: " << kSymbols << " payload symbols ] ~~~"
+            << std::endl;
+
+  std::apply(
+      [&](auto... shapes) {
+        ([&](auto shape) {
+          constexpr auto n = decltype(shape)::kN;
+          constexpr auto k = decltype(shape)::kK;
+          std::vector<ec_cpp::Additive<Descriptor>> codeword(n);
+          auto load = [&](size_t c) {
+            for (size_t i = 0ull; i < k; ++i)
+              codeword[i].point_0 = uint16_t(i * 7 + c);
+          };
+
+          TicToc g;
+          for (size_t c = 0ull; c < kSymbols / k; ++c) {
+            load(c);
+            poly_enc.encodeParityGeneric(codeword.data(), k, k, n);
+          }
+          const auto generic_ms = g.toc().count() / 1000;
+          TicToc f;
+          for (size_t c = 0ull; c < kSymbols / k; ++c) {
+            load(c);
+            poly_enc.encodeParityFixed<n, k>(codeword.data(), k, n);
+          }
+          std::cout << "n = " << n << ", k = " << k << ": generic "
+                    << generic_ms << " ms, fixed " << f.toc().count() / 1000
+                    << " ms" << std::endl;
+        }(shapes),
+         ...);
+      },
+      ec_cpp::FixedShapes{});
+}
+
+void Cpp_MeasureUpdate() {
+  constexpr size_t kPayloadSize = 4ull * 1000ull * 1000ull;
+  constexpr size_t kEdits = 1000ull;
+  constexpr size_t kEditSize = 64ull;
+  std::vector<uint8_t> payload(kPayloadSize);
+  for (size_t i = 0ull; i < payload.size(); ++i)
+    payload[i] = uint8_t(i * 7);
+  std::vector<uint8_t> edit(kEditSize, 0x5a);
+
+  std::cout << "~~~ [ Update: " << kEdits << " edits of " << kEditSize
+            << " bytes in " << kPayloadSize << " bytes ] ~~~" << std::endl;
+  for (const size_t validators : {100ull, 1000ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(validators));
+    TicToc e;
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+    const auto encode_us = e.toc().count();
+
+    TicToc u;
+    for (size_t i = 0ull; i < kEdits; ++i) {
+      const auto offset =
+          (i * 7919ull * kEditSize) % (kPayloadSize - kEditSize);
+      encoder.updateShards(shards, offset, {&payload[offset], kEditSize},
+                           {edit.data(), kEditSize});
+      std::copy(edit.begin(), edit.end(), payload.begin() + offset);
+    }
+    std::cout << "n = " << validators << ": encode " << encode_us
+              << " us, update " << u.toc().count() / kEdits << " us per edit"
+              << std::endl;
+  }
+}
+
+void Cpp_MeasureShardWriter() {
+  constexpr size_t kPayloadSize = 40ull * 1000ull * 1000ull;
+  std::vector<uint8_t> payload(kPayloadSize);
+  for (size_t i = 0ull; i < payload.size(); ++i)
+    payload[i] = uint8_t(i * 7);
+  const ec_cpp::Slice<uint8_t> bytes{payload.data(), payload.size()};
+  const auto dir = std::filesystem::temp_directory_path() /
+                   ("ec_cpp_bench_" + std::to_string(::getpid()));
+  std::filesystem::create_directories(dir);
+
+  std::cout << "~~~ [ Shard persistence: " << kPayloadSize
+            << " bytes ] ~~~" << std::endl;
+  for (const size_t validators : {100ull, 1000ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(validators));
+    std::vector<int> files;
+    for (size_t i = 0ull; i < validators; ++i)
+      files.push_back(::open((dir / std::to_string(i)).c_str(),
+                             O_WRONLY | O_CREAT | O_TRUNC, 0644));
+
+    TicToc s;
+    const auto shards = ec_cpp::resultGetValue(encoder.encode(bytes));
+    for (size_t i = 0ull; i < validators; ++i)
+      ::pwrite(files[i], shards[i].data(), shards[i].size(), 0);
+    std::cout << "n = " << validators << ": encode then write "
+              << s.toc().count() << " us";
+
+    for (const auto backend :
+         {ec_cpp::WriteBackend::kIoUring, ec_cpp::WriteBackend::kThreads}) {
+      ec_cpp::ShardWriter writer(backend);
+      ec_cpp::ShardSet set(validators, encoder.shardLen(bytes.size()));
+      TicToc p;
+      const auto candidate = writer.begin(set, files);
+      encoder.encodeInto(bytes, set, [&](size_t first, size_t last) {
+        writer.write(candidate, first, last);
+      });
+      ec_cpp::resultGetValue(writer.finish(candidate).get());
+      std::cout << (writer.backend() == ec_cpp::WriteBackend::kIoUring
+                        ? ", io_uring "
+                        : ", threads ")
+                << p.toc().count() << " us";
+    }
+    std::cout << std::endl;
+    for (const auto fd : files)
+      ::close(fd);
+  }
+  std::filesystem::remove_all(dir);
+}
+
+void Cpp_MeasureSystematic() {
+  constexpr size_t kPayloadSize = 40ull * 1000ull * 1000ull;
+  std::vector<uint8_t> payload(kPayloadSize);
+  for (size_t i = 0ull; i < payload.size(); ++i)
+    payload[i] = uint8_t(i * 7);
+
+  std::cout << "~~~ [ Systematic reassembly: " << kPayloadSize
+            << " bytes ] ~~~" << std::endl;
+  for (const size_t validators : {100ull, 1000ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(validators));
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+    shards.resize(encoder.k());
+    std::vector<uint8_t> out(payload.size());
+
+    TicToc v;
+    encoder.reconstruct_from_systematic(shards);
+    const auto vector_us = v.toc().count();
+    encoder.reconstructFromSystematicInto(shards, {out.data(), out.size()});
+    const auto into_us = v.toc().count();
+    encoder.reconstructFromSystematicInto(shards, {out.data(), out.size()},
+                                          &ec_cpp::ThreadPool::shared());
+    std::cout << "n = " << validators << ": vector " << vector_us
+              << " us, into buffer " << into_us << " us, pooled "
+              << v.toc().count() << " us" << std::endl;
+  }
+}
+
 int main() {
   Cpp_Measures();
+  Cpp_MeasureBatch();
+  Cpp_MeasureDecode();
+  Cpp_MeasureEngines();
+  Cpp_MeasureDescriptors();
+  Cpp_MeasureFormalDerivative();
+  Cpp_MeasureFixedShapes();
+  Cpp_MeasureUpdate();
+  Cpp_MeasureShardWriter();
+  Cpp_MeasureSystematic();
   return 0;
 }
@@ -9,6 +9,10 @@ namespace ec_cpp {
 
 f2e16_Descriptor field_descriptor;
 PolyEncoder_f2e16 poly_encoder(field_descriptor);
+f2e16_ClmulDescriptor clmul_descriptor;
+PolyEncoder_f2e16_clmul clmul_poly_encoder(clmul_descriptor);
+f2e8_Descriptor f2e8_descriptor;
+PolyEncoder_f2e8 f2e8_poly_encoder(f2e8_descriptor);
 
 constexpr size_t kMaxValidators = f2e16_Descriptor::kFieldSize;
 
@@ -23,7 +27,8 @@ Result<size_t> getRecoveryThreshold(size_t n_validators) {
   return (needed + 1ull);
 }
 
-Result<ReedSolomon<PolyEncoder_f2e16>> create(size_t n_validators) {
+Result<ReedSolomon<PolyEncoder_f2e16>> create(size_t n_validators,
+                                              CodeVersion version) {
   const auto n_wanted = n_validators;
   auto k_wanted_result = getRecoveryThreshold(n_wanted);
   if (resultHasError(k_wanted_result))
@@ -33,7 +38,52 @@ Result<ReedSolomon<PolyEncoder_f2e16>> create(size_t n_validators) {
     return Error::kTooManyValidators;
 
   return ReedSolomon<ec_cpp::PolyEncoder_f2e16>::create(
-      n_wanted, resultGetValue(std::move(k_wanted_result)), poly_encoder);
+      n_wanted, resultGetValue(std::move(k_wanted_result)), poly_encoder,
+      version);
+}
+
+Result<ReedSolomon<PolyEncoder_f2e16_clmul>>
+createClmul(size_t n_validators, CodeVersion version) {
+  auto k_wanted_result = getRecoveryThreshold(n_validators);
+  if (resultHasError(k_wanted_result))
+    return resultGetError(std::move(k_wanted_result));
+
+  return ReedSolomon<PolyEncoder_f2e16_clmul>::create(
+      n_validators, resultGetValue(std::move(k_wanted_result)),
+      clmul_poly_encoder, version);
+}
+
+Result<ReedSolomon<PolyEncoder_f2e8>> createF2e8(size_t n_validators,
+                                                CodeVersion version) {
+  if (n_validators > f2e8_Descriptor::kFieldSize)
+    return Error::kTooManyValidators;
+
+  auto k_wanted_result = getRecoveryThreshold(n_validators);
+  if (resultHasError(k_wanted_result))
+    return resultGetError(std::move(k_wanted_result));
+
+  return ReedSolomon<PolyEncoder_f2e8>::create(
+      n_validators, resultGetValue(std::move(k_wanted_result)),
+      f2e8_poly_encoder, version);
+}
+
+Result<AvailabilitySession<PolyEncoder_f2e16>>
+createAvailabilitySession(size_t n_validators, CodeVersion version) {
+  auto encoder_result = create(n_validators, version);
+  if (resultHasError(encoder_result))
+    return resultGetError(std::move(encoder_result));
+
+  return AvailabilitySession<PolyEncoder_f2e16>{
+      resultGetValue(std::move(encoder_result))};
+}
+
+Result<Hash256> computeErasureRoot(Slice<uint8_t> payload,
+                                   size_t n_validators) {
+  auto encoder_result = create(n_validators);
+  if (resultHasError(encoder_result))
+    return resultGetError(std::move(encoder_result));
+
+  return resultGetValue(std::move(encoder_result)).erasureRoot(payload);
 }
 
 } // namespace ec_cpp
@@ -6,8 +6,50 @@
 #ifndef NOVELPOLY_REED_SOLOMON_CRUST_ADDITIVE_FFT_HPP
 #define NOVELPOLY_REED_SOLOMON_CRUST_ADDITIVE_FFT_HPP
 
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <ec-cpp/cpu.hpp>
+
 namespace ec_cpp {
 
+/// Descriptors that multiply without the log and exp tables: a multiplier
+/// is turned once into a `Constant`, which `mulConstant` then applies.
+template <typename D>
+concept TableFreeProduct =
+    requires(typename D::Elt x, typename D::Multiplier log,
+             const typename D::Tables &tables) {
+      { D::constant(log, tables) } -> std::same_as<typename D::Constant>;
+      {
+        D::mulConstant(x, D::constant(log, tables))
+      } -> std::same_as<typename D::Elt>;
+    };
+
+/// The form a fixed multiplier is applied in: the log itself for table
+/// descriptors.
+template <typename D> struct ProductFactor {
+  using type = typename D::Multiplier;
+};
+
+template <TableFreeProduct D> struct ProductFactor<D> {
+  using type = typename D::Constant;
+};
+
+/// Runs `f(std::type_identity<Kernel>{})` with the type whose static
+/// `mulConstant` the transforms apply: what `D::withKernel` picks for this
+/// CPU where the descriptor has several, `D` itself otherwise. A transform
+/// instantiated under it checks the CPU once rather than per product.
+template <typename D, typename F> decltype(auto) withKernel(const F &f) {
+  if constexpr (requires { D::withKernel(f); })
+    return D::withKernel(f);
+  else
+    return f(std::type_identity<D>{});
+}
+
 template <typename TDescriptor> struct Additive {
   using Descriptor = TDescriptor;
   typename Descriptor::Elt point_0;
@@ -20,6 +62,10 @@ template <typename TDescriptor> struct Additive {
 
   Additive mul(typename Descriptor::Multiplier other,
                const typename Descriptor::Tables &tables) {
+    if constexpr (TableFreeProduct<Descriptor>)
+      return Additive{Descriptor::mulConstant(
+          point_0, Descriptor::constant(other, tables))};
+
     if (point_0 == typename Descriptor::Elt(0))
       return Additive{0};
 
@@ -40,6 +86,38 @@ template <typename TDescriptor> struct Additive {
   }
 };
 
+/// Products by one multiplier as one table per byte of the symbol, indexed
+/// by that byte: for 16-bit symbols two independent lookups into 1 KB and an
+/// XOR, for 8-bit ones the whole product in one lookup.
+template <typename TDescriptor> struct SplitProduct {
+  using Descriptor = TDescriptor;
+  static constexpr size_t kBytes = Descriptor::kFieldBits / 8ull;
+  static_assert(kBytes * 8ull == Descriptor::kFieldBits && kBytes <= 2ull,
+                "split in the bytes of an 8-bit or 16-bit symbol");
+
+  /// `bytes[b][v]`: the product of the symbol with byte `b` set to `v`.
+  typename Descriptor::Elt bytes[kBytes][256];
+
+  SplitProduct(typename Descriptor::Multiplier log,
+               const typename Descriptor::Tables &tables) {
+    for (size_t i = 0ull; i < kBytes; ++i)
+      for (size_t v = 0ull; v < 256ull; ++v)
+        bytes[i][v] =
+            Additive<Descriptor>{typename Descriptor::Elt(v << (i * 8ull))}
+                .mul(log, tables)
+                .point_0;
+  }
+
+  typename Descriptor::Elt apply(typename Descriptor::Elt x) const {
+    if constexpr (kBytes == 1ull)
+      return bytes[0][x];
+    else
+      return bytes[0][x & 0xff] ^ bytes[1][x >> 8];
+  }
+};
+
+template <typename TDescriptor> class SkewProducts;
+
 template <typename TDescriptor> struct AdditiveFFT {
   using Descriptor = TDescriptor;
   typename Descriptor::Multiplier skews[size_t(Descriptor::kOneMask)];
@@ -96,49 +174,453 @@ template <typename TDescriptor> struct AdditiveFFT {
     return result;
   }
 
+  /// Sub-transforms up to this many symbols are run layer by layer; larger
+  /// ones recurse on their quarters so each quarter is transformed while it
+  /// stays in L1, and join them with one pass over the top two layers.
+  static constexpr size_t kResidentSize = 8192ull;
+
   void inverse_afft(Additive<Descriptor> *data, size_t size, size_t index,
-                    const typename Descriptor::Tables &tables) const {
-    size_t depart_no(1ull);
-    while (depart_no < size) {
-      size_t j(depart_no);
-      while (j < size) {
-        for (size_t i = (j - depart_no); i < j; ++i)
-          data[i + depart_no].point_0 =
-              (data[i + depart_no].point_0 ^ data[i].point_0);
-
-        const auto skew = skews[j + index - 1ull];
-        if (skew != Descriptor::kOneMask)
-          for (size_t i = (j - depart_no); i < j; ++i)
-            data[i].point_0 = (data[i].point_0 ^
-                               data[i + depart_no].mul(skew, tables).point_0);
-
-        j += (depart_no << 1ull);
+                    const typename Descriptor::Tables &tables,
+                    const SkewProducts<Descriptor> *products = nullptr) const {
+    withKernel<Descriptor>([&](auto kernel) {
+      inverseAfftWith<typename decltype(kernel)::type>(data, size, index,
+                                                       tables, products);
+    });
+  }
+
+  /// `inverse_afft` with the products of `Kernel`, for a caller that runs
+  /// several transforms under one `withKernel`.
+  template <typename Kernel>
+  void
+  inverseAfftWith(Additive<Descriptor> *data, size_t size, size_t index,
+                  const typename Descriptor::Tables &tables,
+                  const SkewProducts<Descriptor> *products = nullptr) const {
+    if (size > kResidentSize) {
+      const auto quarter = size >> 2ull;
+      for (size_t q = 0ull; q < size; q += quarter)
+        inverseAfftWith<Kernel>(data + q, quarter, index + q, tables,
+                                products);
+      inverseLayersWith<Kernel>(data, size, index, quarter, size, tables,
+                                products);
+      return;
+    }
+    inverseLayersWith<Kernel>(data, size, index, 1ull, size, tables,
+                              products);
+  }
+
+  /// The layers of `inverse_afft` with `depart_no` in `[first, last)`, so a
+  /// caller can run the low layers block by block while they fit in cache.
+  /// Layers are taken two at a time where possible.
+  void inverseLayers(Additive<Descriptor> *data, size_t size, size_t index,
+                     size_t first, size_t last,
+                     const typename Descriptor::Tables &tables,
+                     const SkewProducts<Descriptor> *products = nullptr) const {
+    withKernel<Descriptor>([&](auto kernel) {
+      inverseLayersWith<typename decltype(kernel)::type>(
+          data, size, index, first, last, tables, products);
+    });
+  }
+
+  template <typename Kernel>
+  void
+  inverseLayersWith(Additive<Descriptor> *data, size_t size, size_t index,
+                    size_t first, size_t last,
+                    const typename Descriptor::Tables &tables,
+                    const SkewProducts<Descriptor> *products = nullptr) const {
+    last = std::min(last, size);
+    size_t depart_no(first);
+    while (depart_no < last) {
+      if ((depart_no << 1ull) < last) {
+        inverseLayerPair<Kernel>(data, size, index, depart_no, tables,
+                                 products);
+        depart_no = (depart_no << 2ull);
+      } else {
+        inverseLayer<Kernel>(data, size, index, depart_no, tables, products);
+        depart_no = (depart_no << 1ull);
       }
-      depart_no = (depart_no << 1ull);
     }
   }
 
+  /// The butterfly of the lowest inverse layer on the pair that skew `j`
+  /// joins, for a caller that fuses that layer into the pass loading it.
+  template <typename Kernel>
+  EC_CPP_ALWAYS_INLINE void
+  inverseButterflyAt(Additive<Descriptor> &lo, Additive<Descriptor> &hi,
+                     size_t j, const typename Descriptor::Tables &tables,
+                     const SkewProducts<Descriptor> *products) const {
+    inverseButterfly<Kernel>(lo, hi, prepare(j, tables, products), tables);
+  }
+
   void afft(Additive<Descriptor> *data, size_t size, size_t index,
-            const typename Descriptor::Tables &tables) const {
+            const typename Descriptor::Tables &tables,
+            const SkewProducts<Descriptor> *products = nullptr) const {
+    withKernel<Descriptor>([&](auto kernel) {
+      afftWith<typename decltype(kernel)::type>(data, size, index, tables,
+                                                products);
+    });
+  }
+
+  /// `afft` with the products of `Kernel`.
+  template <typename Kernel>
+  void afftWith(Additive<Descriptor> *data, size_t size, size_t index,
+                const typename Descriptor::Tables &tables,
+                const SkewProducts<Descriptor> *products = nullptr) const {
+    if (size > kResidentSize) {
+      const auto quarter = size >> 2ull;
+      forwardLayersWith<Kernel>(data, size, index, quarter, size, tables,
+                                products);
+      for (size_t q = 0ull; q < size; q += quarter)
+        afftWith<Kernel>(data + q, quarter, index + q, tables, products);
+      return;
+    }
+    forwardLayersWith<Kernel>(data, size, index, 1ull, size, tables,
+                              products);
+  }
+
+  /// The layers of `afft` with `depart_no` in `[first, last)`, highest
+  /// first, two at a time where possible.
+  void forwardLayers(Additive<Descriptor> *data, size_t size, size_t index,
+                     size_t first, size_t last,
+                     const typename Descriptor::Tables &tables,
+                     const SkewProducts<Descriptor> *products = nullptr) const {
+    withKernel<Descriptor>([&](auto kernel) {
+      forwardLayersWith<typename decltype(kernel)::type>(
+          data, size, index, first, last, tables, products);
+    });
+  }
+
+  template <typename Kernel>
+  void
+  forwardLayersWith(Additive<Descriptor> *data, size_t size, size_t index,
+                    size_t first, size_t last,
+                    const typename Descriptor::Tables &tables,
+                    const SkewProducts<Descriptor> *products = nullptr) const {
     size_t depart_no(size >> 1ull);
-    while (depart_no > 0) {
-      size_t j(depart_no);
-      while (j < size) {
-        const auto skew = skews[j + index - 1ull];
-        if (skew != Descriptor::kOneMask)
-          for (size_t i = (j - depart_no); i < j; ++i)
-            data[i].point_0 =
-                data[i].point_0 ^ data[i + depart_no].mul(skew, tables).point_0;
-
-        for (size_t i = (j - depart_no); i < j; ++i)
-          data[i + depart_no].point_0 =
-              data[i + depart_no].point_0 ^ data[i].point_0;
-
-        j += (depart_no << 1ull);
-      }
+    while (depart_no >= last)
       depart_no = (depart_no >> 1ull);
+    while (depart_no >= first && depart_no > 0) {
+      if ((depart_no >> 1ull) >= first && (depart_no >> 1ull) > 0) {
+        forwardLayerPair<Kernel>(data, size, index, depart_no >> 1ull, tables,
+                                 products);
+        depart_no = (depart_no >> 2ull);
+      } else {
+        forwardLayer<Kernel>(data, size, index, depart_no, tables, products);
+        depart_no = (depart_no >> 1ull);
+      }
+    }
+  }
+
+  /// `inverse_afft` of a size and offset known at compile time. The layer
+  /// loops get constant bounds and the skews constant offsets, for the
+  /// compiler to unroll; the result is the same.
+  template <size_t Size, size_t Index>
+  void
+  inverseAfftFixed(Additive<Descriptor> *data,
+                   const typename Descriptor::Tables &tables,
+                   const SkewProducts<Descriptor> *products = nullptr) const {
+    withKernel<Descriptor>([&](auto kernel) {
+      inverseAfftFixedWith<typename decltype(kernel)::type, Size, Index>(
+          data, tables, products);
+    });
+  }
+
+  /// `afft` of a size and offset known at compile time, the mirror of
+  /// `inverseAfftFixed`.
+  template <size_t Size, size_t Index>
+  void afftFixed(Additive<Descriptor> *data,
+                 const typename Descriptor::Tables &tables,
+                 const SkewProducts<Descriptor> *products = nullptr) const {
+    withKernel<Descriptor>([&](auto kernel) {
+      afftFixedWith<typename decltype(kernel)::type, Size, Index>(
+          data, tables, products);
+    });
+  }
+
+  /// The layers of `afft` above `keep` when only the outputs `[0, keep)`
+  /// are wanted: each one folds the upper half of the leading block into
+  /// the lower half and leaves the rest unchanged. Finishing with
+  /// `afft(data, keep, 0)` gives the same `[0, keep)` as a full `afft`.
+  void foldToPrefix(Additive<Descriptor> *data, size_t size, size_t keep,
+                    const typename Descriptor::Tables &tables,
+                    const SkewProducts<Descriptor> *products = nullptr) const {
+    withKernel<Descriptor>([&](auto kernel) {
+      foldToPrefixWith<typename decltype(kernel)::type>(data, size, keep,
+                                                        tables, products);
+    });
+  }
+
+  template <typename Kernel>
+  void
+  foldToPrefixWith(Additive<Descriptor> *data, size_t size, size_t keep,
+                   const typename Descriptor::Tables &tables,
+                   const SkewProducts<Descriptor> *products = nullptr) const {
+    for (size_t depart_no = (size >> 1ull); depart_no >= keep && depart_no > 0;
+         depart_no = (depart_no >> 1ull)) {
+      const auto skew = prepare(depart_no - 1ull, tables, products);
+      if (skew.multiply)
+        for (size_t i = 0ull; i < depart_no; ++i)
+          data[i].point_0 = data[i].point_0 ^
+                            times<Kernel>(data[i + depart_no], skew, tables);
     }
   }
+
+private:
+  using Multiplier = typename Descriptor::Multiplier;
+
+  /// A skew prepared for the butterflies: whether it multiplies at all, the
+  /// factor it multiplies by and its split product tables when there are
+  /// some.
+  struct Skew {
+    bool multiply;
+    typename ProductFactor<Descriptor>::type factor;
+    const SplitProduct<Descriptor> *table;
+  };
+
+  Skew prepare(size_t j, const typename Descriptor::Tables &tables,
+               const SkewProducts<Descriptor> *products) const {
+    const auto skew = skews[j];
+    const auto *table = products ? products->find(j) : nullptr;
+    if constexpr (TableFreeProduct<Descriptor>)
+      return {skew != Descriptor::kOneMask,
+              Descriptor::constant(skew, tables), table};
+    else
+      return {skew != Descriptor::kOneMask, skew, table};
+  }
+
+  template <typename Kernel, size_t Size, size_t Index>
+  void inverseAfftFixedWith(Additive<Descriptor> *data,
+                            const typename Descriptor::Tables &tables,
+                            const SkewProducts<Descriptor> *products) const {
+    static_assert(Size != 0ull && (Size & (Size - 1ull)) == 0ull);
+    if constexpr (Size > kResidentSize) {
+      constexpr auto kQuarter = Size >> 2ull;
+      inverseAfftFixedWith<Kernel, kQuarter, Index>(data, tables, products);
+      inverseAfftFixedWith<Kernel, kQuarter, Index + kQuarter>(
+          data + kQuarter, tables, products);
+      inverseAfftFixedWith<Kernel, kQuarter, Index + 2ull * kQuarter>(
+          data + 2ull * kQuarter, tables, products);
+      inverseAfftFixedWith<Kernel, kQuarter, Index + 3ull * kQuarter>(
+          data + 3ull * kQuarter, tables, products);
+      inverseLayersFixed<Kernel, Size, Index, kQuarter, Size>(data, tables,
+                                                              products);
+    } else {
+      inverseLayersFixed<Kernel, Size, Index, 1ull, Size>(data, tables,
+                                                          products);
+    }
+  }
+
+  template <typename Kernel, size_t Size, size_t Index>
+  void afftFixedWith(Additive<Descriptor> *data,
+                     const typename Descriptor::Tables &tables,
+                     const SkewProducts<Descriptor> *products) const {
+    static_assert(Size != 0ull && (Size & (Size - 1ull)) == 0ull);
+    if constexpr (Size > kResidentSize) {
+      constexpr auto kQuarter = Size >> 2ull;
+      forwardLayersFixed<Kernel, Size, Index, kQuarter, (Size >> 1ull)>(
+          data, tables, products);
+      afftFixedWith<Kernel, kQuarter, Index>(data, tables, products);
+      afftFixedWith<Kernel, kQuarter, Index + kQuarter>(data + kQuarter,
+                                                        tables, products);
+      afftFixedWith<Kernel, kQuarter, Index + 2ull * kQuarter>(
+          data + 2ull * kQuarter, tables, products);
+      afftFixedWith<Kernel, kQuarter, Index + 3ull * kQuarter>(
+          data + 3ull * kQuarter, tables, products);
+    } else {
+      forwardLayersFixed<Kernel, Size, Index, 1ull, (Size >> 1ull)>(
+          data, tables, products);
+    }
+  }
+
+  /// `inverseLayers` over `[First, Last)` with every bound a constant.
+  template <typename Kernel, size_t Size, size_t Index, size_t First,
+            size_t Last>
+  EC_CPP_ALWAYS_INLINE void
+  inverseLayersFixed(Additive<Descriptor> *data,
+                     const typename Descriptor::Tables &tables,
+                     const SkewProducts<Descriptor> *products) const {
+    if constexpr (First < Last) {
+      if constexpr ((First << 1ull) < Last) {
+        inverseLayerPair<Kernel>(data, Size, Index, First, tables, products);
+        inverseLayersFixed<Kernel, Size, Index, (First << 2ull), Last>(
+            data, tables, products);
+      } else {
+        inverseLayer<Kernel>(data, Size, Index, First, tables, products);
+        inverseLayersFixed<Kernel, Size, Index, (First << 1ull), Last>(
+            data, tables, products);
+      }
+    }
+  }
+
+  /// `forwardLayers` from `DepartNo` down to `First` with every bound a
+  /// constant.
+  template <typename Kernel, size_t Size, size_t Index, size_t First,
+            size_t DepartNo>
+  EC_CPP_ALWAYS_INLINE void
+  forwardLayersFixed(Additive<Descriptor> *data,
+                     const typename Descriptor::Tables &tables,
+                     const SkewProducts<Descriptor> *products) const {
+    if constexpr (DepartNo >= First && DepartNo > 0ull) {
+      if constexpr ((DepartNo >> 1ull) >= First && (DepartNo >> 1ull) > 0ull) {
+        forwardLayerPair<Kernel>(data, Size, Index, (DepartNo >> 1ull),
+                                 tables, products);
+        forwardLayersFixed<Kernel, Size, Index, First, (DepartNo >> 2ull)>(
+            data, tables, products);
+      } else {
+        forwardLayer<Kernel>(data, Size, Index, DepartNo, tables, products);
+        forwardLayersFixed<Kernel, Size, Index, First, (DepartNo >> 1ull)>(
+            data, tables, products);
+      }
+    }
+  }
+
+  template <typename Kernel>
+  EC_CPP_ALWAYS_INLINE static typename Descriptor::Elt
+  times(Additive<Descriptor> x, const Skew &skew,
+        const typename Descriptor::Tables &tables) {
+    if (skew.table)
+      return skew.table->apply(x.point_0);
+    if constexpr (TableFreeProduct<Descriptor>)
+      return Kernel::mulConstant(x.point_0, skew.factor);
+    else
+      return x.mul(skew.factor, tables).point_0;
+  }
+
+  template <typename Kernel>
+  EC_CPP_ALWAYS_INLINE static void
+  inverseButterfly(Additive<Descriptor> &lo, Additive<Descriptor> &hi,
+                   const Skew &skew,
+                   const typename Descriptor::Tables &tables) {
+    hi.point_0 = hi.point_0 ^ lo.point_0;
+    if (skew.multiply)
+      lo.point_0 = lo.point_0 ^ times<Kernel>(hi, skew, tables);
+  }
+
+  template <typename Kernel>
+  EC_CPP_ALWAYS_INLINE static void
+  forwardButterfly(Additive<Descriptor> &lo, Additive<Descriptor> &hi,
+                   const Skew &skew,
+                   const typename Descriptor::Tables &tables) {
+    if (skew.multiply)
+      lo.point_0 = lo.point_0 ^ times<Kernel>(hi, skew, tables);
+    hi.point_0 = hi.point_0 ^ lo.point_0;
+  }
+
+  template <typename Kernel>
+  EC_CPP_ALWAYS_INLINE void
+  inverseLayer(Additive<Descriptor> *data, size_t size, size_t index,
+               size_t depart_no, const typename Descriptor::Tables &tables,
+               const SkewProducts<Descriptor> *products) const {
+    for (size_t j = depart_no; j < size; j += (depart_no << 1ull)) {
+      const auto skew = prepare(j + index - 1ull, tables, products);
+      for (size_t i = (j - depart_no); i < j; ++i)
+        inverseButterfly<Kernel>(data[i], data[i + depart_no], skew,
+                                 tables);
+    }
+  }
+
+  /// Layers `depart_no` and `2 * depart_no` in one pass: each group of four
+  /// symbols goes through both layers in registers and the three skews of
+  /// a group of `4 * depart_no` are loaded once.
+  template <typename Kernel>
+  EC_CPP_ALWAYS_INLINE void
+  inverseLayerPair(Additive<Descriptor> *data, size_t size, size_t index,
+                   size_t depart_no, const typename Descriptor::Tables &tables,
+                   const SkewProducts<Descriptor> *products) const {
+    const auto d = depart_no;
+    for (size_t s = 0ull; s < size; s += (d << 2ull)) {
+      const auto skew_0 = prepare(s + d + index - 1ull, tables, products);
+      const auto skew_1 =
+          prepare(s + 3ull * d + index - 1ull, tables, products);
+      const auto skew_2 =
+          prepare(s + 2ull * d + index - 1ull, tables, products);
+      for (size_t i = s; i < s + d; ++i) {
+        auto a = data[i];
+        auto b = data[i + d];
+        auto c = data[i + 2ull * d];
+        auto e = data[i + 3ull * d];
+        inverseButterfly<Kernel>(a, b, skew_0, tables);
+        inverseButterfly<Kernel>(c, e, skew_1, tables);
+        inverseButterfly<Kernel>(a, c, skew_2, tables);
+        inverseButterfly<Kernel>(b, e, skew_2, tables);
+        data[i] = a;
+        data[i + d] = b;
+        data[i + 2ull * d] = c;
+        data[i + 3ull * d] = e;
+      }
+    }
+  }
+
+  template <typename Kernel>
+  EC_CPP_ALWAYS_INLINE void
+  forwardLayer(Additive<Descriptor> *data, size_t size, size_t index,
+               size_t depart_no, const typename Descriptor::Tables &tables,
+               const SkewProducts<Descriptor> *products) const {
+    for (size_t j = depart_no; j < size; j += (depart_no << 1ull)) {
+      const auto skew = prepare(j + index - 1ull, tables, products);
+      for (size_t i = (j - depart_no); i < j; ++i)
+        forwardButterfly<Kernel>(data[i], data[i + depart_no], skew,
+                                 tables);
+    }
+  }
+
+  /// Layers `2 * depart_no` and `depart_no` in one pass, the mirror of
+  /// `inverseLayerPair`.
+  template <typename Kernel>
+  EC_CPP_ALWAYS_INLINE void
+  forwardLayerPair(Additive<Descriptor> *data, size_t size, size_t index,
+                   size_t depart_no, const typename Descriptor::Tables &tables,
+                   const SkewProducts<Descriptor> *products) const {
+    const auto d = depart_no;
+    for (size_t s = 0ull; s < size; s += (d << 2ull)) {
+      const auto skew_0 = prepare(s + d + index - 1ull, tables, products);
+      const auto skew_1 =
+          prepare(s + 3ull * d + index - 1ull, tables, products);
+      const auto skew_2 =
+          prepare(s + 2ull * d + index - 1ull, tables, products);
+      for (size_t i = s; i < s + d; ++i) {
+        auto a = data[i];
+        auto b = data[i + d];
+        auto c = data[i + 2ull * d];
+        auto e = data[i + 3ull * d];
+        forwardButterfly<Kernel>(a, c, skew_2, tables);
+        forwardButterfly<Kernel>(b, e, skew_2, tables);
+        forwardButterfly<Kernel>(a, b, skew_0, tables);
+        forwardButterfly<Kernel>(c, e, skew_1, tables);
+        data[i] = a;
+        data[i + d] = b;
+        data[i + 2ull * d] = c;
+        data[i + 3ull * d] = e;
+      }
+    }
+  }
+};
+
+/// Split product tables for the skews of the wide transform layers, those
+/// with `depart_no >= kMinDepart`, where one table serves at least that many
+/// butterflies of every column. Skew `j` is only ever used by the layer with
+/// `depart_no` the lowest set bit of `j + 1`, whatever the size and offset
+/// of the transform, so one set serves every transform of the field.
+template <typename TDescriptor> class SkewProducts final {
+public:
+  using Descriptor = TDescriptor;
+  static constexpr size_t kMinDepart = 64ull;
+
+  SkewProducts(const AdditiveFFT<Descriptor> &afft,
+               const typename Descriptor::Tables &tables) {
+    tables_.reserve(Descriptor::kFieldSize / kMinDepart);
+    for (size_t j = kMinDepart - 1ull; j < size_t(Descriptor::kOneMask);
+         j += kMinDepart)
+      tables_.emplace_back(afft.skews[j], tables);
+  }
+
+  const SplitProduct<Descriptor> *find(size_t j) const {
+    if (((j + 1ull) & (kMinDepart - 1ull)) != 0ull)
+      return nullptr;
+    return &tables_[(j + 1ull) / kMinDepart - 1ull];
+  }
+
+private:
+  std::vector<SplitProduct<Descriptor>> tables_;
 };
 
 } // namespace ec_cpp
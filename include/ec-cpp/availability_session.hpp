@@ -0,0 +1,162 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_AVAILABILITY_SESSION_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_AVAILABILITY_SESSION_HPP
+
+#include <assert.h>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdlib.h>
+#include <vector>
+
+#include <ec-cpp/errors.hpp>
+#include <ec-cpp/math.hpp>
+#include <ec-cpp/reed-solomon.hpp>
+#include <ec-cpp/types.hpp>
+
+namespace ec_cpp {
+
+/// Collects the chunks of one payload as they arrive from peers and
+/// recovers the payload as soon as `k` of them are present.
+///
+/// Only the first `k` chunks are kept, in storage allocated once the chunk
+/// length is known. The erasure pattern is tracked incrementally: for every
+/// power-of-two prefix `m` the decode may run over, the log of the erasure
+/// locator at each position is updated on insert, so the `k`-th chunk
+/// starts the decode without a Walsh transform or a scan of the chunks.
+/// Chunks are kept by codeword position, the zero positions of a `kV2` code
+/// being present from the start.
+template <typename TPolyEncoder> class AvailabilitySession final {
+public:
+  using Codec = ReedSolomon<TPolyEncoder>;
+  using Descriptor = typename TPolyEncoder::Descriptor;
+
+  explicit AvailabilitySession(const Codec &codec)
+      : codec_{codec}, present_(codec.n(), false), chunks_(codec.n()) {
+    const auto &log_table = logTable();
+    for (size_t m = 2 * codec_.block(); m <= codec_.n(); m *= 2) {
+      /// With every position erased, position `i` sees all `i + j`, which
+      /// for `i < m` run over `[0, m)`.
+      typename Descriptor::Wide all = 0;
+      for (size_t x = 1ull; x < m; ++x)
+        all = (all + log_table[x]) % Descriptor::kOneMask;
+      erased_logs_.emplace_back(m, typename Descriptor::Multiplier(all));
+    }
+    for (size_t p = codec_.k(); p < codec_.block(); ++p) {
+      present_[p] = true;
+      markPresent(p);
+    }
+  }
+
+  /// Add chunk `index`. Chunks must all have the same length and each index
+  /// may be given only once. Chunks arriving once the payload is recovered
+  /// are validated and dropped.
+  /// @return true once the payload has been recovered
+  Result<bool> addChunk(size_t index, Slice<const uint8_t> bytes) {
+    if (index >= codec_.wantedN())
+      return Error::kChunkIndexOutOfRange;
+    if (bytes.size() / Codec::kSymbolBytes == 0ull)
+      return Error::kEmptyShard;
+    if (chunk_len_ != 0ull && bytes.size() != chunk_len_)
+      return Error::kInconsistentShardLengths;
+    const auto p = codec_.position(index);
+    if (present_[p])
+      return Error::kDuplicateChunk;
+
+    present_[p] = true;
+    if (complete())
+      return true;
+
+    if (chunk_len_ == 0ull) {
+      /// The first `k` slots take the chunks as they come, the rest stay
+      /// zero for the zero positions.
+      chunk_len_ = bytes.size();
+      storage_.resize(chunk_len_ * codec_.block());
+      for (size_t z = codec_.k(); z < codec_.block(); ++z)
+        chunks_[z] = {storage_.data() + z * chunk_len_, chunk_len_};
+    }
+    auto *slot = storage_.data() + received_ * chunk_len_;
+    memcpy(slot, bytes.data(), chunk_len_);
+    chunks_[p] = {slot, chunk_len_};
+    last_ = std::max(last_, p + 1);
+    ++received_;
+
+    markPresent(p);
+    if (received_ == codec_.k())
+      recover();
+    return complete();
+  }
+
+  /// Number of chunks kept for the decode, at most `k`.
+  size_t received() const { return received_; }
+
+  bool complete() const { return !data_.empty(); }
+
+  /// The recovered payload, zero padded as `ReedSolomon::reconstruct`
+  /// returns it. Empty until `complete()`.
+  const std::vector<uint8_t> &data() const { return data_; }
+
+private:
+  const auto &logTable() const {
+    return std::get<0>(codec_.polyEncoder().descriptor().kTables);
+  }
+
+  void markPresent(size_t index) {
+    const auto &log_table = logTable();
+    for (auto &logs : erased_logs_) {
+      if (index >= logs.size())
+        continue;
+      for (size_t i = 0ull; i < logs.size(); ++i)
+        if (i != index)
+          logs[i] = typename Descriptor::Multiplier(
+              (typename Descriptor::Wide(logs[i]) + Descriptor::kOneMask -
+               log_table[i ^ index]) %
+              Descriptor::kOneMask);
+    }
+  }
+
+  void recover() {
+    const auto k = codec_.k();
+    const auto shard_len = chunk_len_ / Codec::kSymbolBytes;
+    if (last_ == k) {
+      data_.resize(shard_len * Codec::kSymbolBytes * k);
+      codec_.interleaveSystematic(chunks_, shard_len, data_.data());
+      return;
+    }
+
+    const auto block = codec_.block();
+    const auto m = std::max(2 * block, math::nextHighPowerOf2(last_));
+    const auto &logs = erased_logs_[math::log2(m / (2 * block))];
+    assert(logs.size() == m);
+
+    /// Same layout as `PolyEncoder::evalErrorPolynomial` gives: the
+    /// reciprocal at erased positions.
+    auto error_poly = std::make_unique<typename Codec::ErrorPolynomial>();
+    for (size_t i = 0ull; i < m; ++i)
+      (*error_poly)[i] =
+          present_[i] ? logs[i]
+                      : typename Descriptor::Multiplier(Descriptor::kOneMask -
+                                                        logs[i]);
+    data_ = codec_.decodePrefix(chunks_, m, *error_poly, shard_len);
+  }
+
+  const Codec codec_;
+  std::vector<bool> present_;
+  std::vector<Slice<const uint8_t>> chunks_;
+  std::vector<uint8_t> storage_;
+  /// `erased_logs_[l][i]`: log of the product of `i + j` over the erased
+  /// `j` of the prefix of size `2 * block << l`.
+  std::vector<std::vector<typename Descriptor::Multiplier>> erased_logs_;
+  std::vector<uint8_t> data_;
+  size_t chunk_len_ = 0ull;
+  size_t received_ = 0ull;
+  size_t last_ = 0ull;
+};
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_AVAILABILITY_SESSION_HPP
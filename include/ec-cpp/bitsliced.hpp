@@ -0,0 +1,240 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_BITSLICED_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_BITSLICED_HPP
+
+#include <assert.h>
+#include <cstdint>
+#include <cstring>
+#include <stdlib.h>
+#include <vector>
+
+#include <ec-cpp/additive_fft.hpp>
+#include <ec-cpp/cpu.hpp>
+#include <ec-cpp/formal_derivative.hpp>
+
+namespace ec_cpp {
+
+/// Transform engine used by the encode and decode paths of `ReedSolomon`.
+enum class TransformEngine {
+  /// One column at a time, multiplying through the log and exp tables.
+  kLogExp,
+  /// `bitsliced::kLanes` columns at a time in bit-sliced form, see
+  /// `BitslicedEngine`.
+  kBitsliced,
+};
+
+namespace bitsliced {
+
+/// Columns per word.
+constexpr size_t kLanes = 64ull;
+
+/// One codeword position of `kLanes` columns: bit `t` of `plane[b]` is bit
+/// `b` of the symbol of column `t`.
+struct Word {
+  uint64_t plane[16];
+};
+
+/// Multiplication by a constant, which is linear over GF(2): bit `c` of row
+/// `r` is bit `r` of the product of the constant with `1 << c`. Rows are
+/// kept split in nibbles, `nibbles[r][g]` being bits `4g..4g + 3` of row
+/// `r`.
+struct Matrix {
+  uint8_t nibbles[16][4];
+};
+
+/// Transposes the 8x8 bit matrix held one row per byte.
+EC_CPP_ALWAYS_INLINE uint64_t transpose8x8(uint64_t x) {
+  auto t = (x ^ (x >> 7ull)) & 0x00AA00AA00AA00AAull;
+  x = x ^ t ^ (t << 7ull);
+  t = (x ^ (x >> 14ull)) & 0x0000CCCC0000CCCCull;
+  x = x ^ t ^ (t << 14ull);
+  t = (x ^ (x >> 28ull)) & 0x00000000F0F0F0F0ull;
+  return x ^ t ^ (t << 28ull);
+}
+
+/// Bit-slices `symbols[0..kLanes)` into `w`.
+inline void pack(const uint16_t *symbols, Word &w) {
+  memset(w.plane, 0, sizeof(w.plane));
+  for (size_t g = 0ull; g < kLanes / 8ull; ++g) {
+    uint64_t lo = 0ull, hi = 0ull;
+    for (size_t t = 0ull; t < 8ull; ++t) {
+      lo |= uint64_t(symbols[g * 8ull + t] & 0xff) << (t * 8ull);
+      hi |= uint64_t(symbols[g * 8ull + t] >> 8ull) << (t * 8ull);
+    }
+    lo = transpose8x8(lo);
+    hi = transpose8x8(hi);
+    for (size_t b = 0ull; b < 8ull; ++b) {
+      w.plane[b] |= ((lo >> (b * 8ull)) & 0xffull) << (g * 8ull);
+      w.plane[b + 8ull] |= ((hi >> (b * 8ull)) & 0xffull) << (g * 8ull);
+    }
+  }
+}
+
+/// Inverse of `pack`.
+inline void unpack(const Word &w, uint16_t *symbols) {
+  for (size_t g = 0ull; g < kLanes / 8ull; ++g) {
+    uint64_t lo = 0ull, hi = 0ull;
+    for (size_t b = 0ull; b < 8ull; ++b) {
+      lo |= ((w.plane[b] >> (g * 8ull)) & 0xffull) << (b * 8ull);
+      hi |= ((w.plane[b + 8ull] >> (g * 8ull)) & 0xffull) << (b * 8ull);
+    }
+    lo = transpose8x8(lo);
+    hi = transpose8x8(hi);
+    for (size_t t = 0ull; t < 8ull; ++t)
+      symbols[g * 8ull + t] = uint16_t(((lo >> (t * 8ull)) & 0xff) |
+                                       (((hi >> (t * 8ull)) & 0xff) << 8ull));
+  }
+}
+
+/// `dst ^= m * src`. The XOR schedule is the four-Russians one: every
+/// combination of each group of four source planes is formed once, then each
+/// destination plane takes one combination per group, selected by the
+/// nibbles of its row.
+EC_CPP_ALWAYS_INLINE void mulAdd(Word &dst, const Word &src, const Matrix &m) {
+  uint64_t combos[4][16];
+  for (size_t g = 0ull; g < 4ull; ++g) {
+    const auto *p = &src.plane[g * 4ull];
+    auto *c = combos[g];
+    c[0] = 0ull;
+    c[1] = p[0];
+    c[2] = p[1];
+    c[3] = p[0] ^ p[1];
+    for (size_t v = 0ull; v < 4ull; ++v) {
+      c[4 + v] = c[v] ^ p[2];
+      c[8 + v] = c[v] ^ p[3];
+      c[12 + v] = c[4 + v] ^ p[3];
+    }
+  }
+  for (size_t r = 0ull; r < 16ull; ++r) {
+    const auto *n = m.nibbles[r];
+    dst.plane[r] ^= combos[0][n[0]] ^ combos[1][n[1]] ^ combos[2][n[2]] ^
+                    combos[3][n[3]];
+  }
+}
+
+EC_CPP_ALWAYS_INLINE void xorAssign(Word &dst, const Word &src) {
+  for (size_t b = 0ull; b < 16ull; ++b)
+    dst.plane[b] ^= src.plane[b];
+}
+
+} // namespace bitsliced
+
+/// The transforms of `PolyEncoder` over `bitsliced::kLanes` columns at
+/// once. Every multiplication is by a constant known ahead of the column
+/// data, either a skew or an error polynomial value, so it is done as a
+/// fixed XOR schedule on the bit planes and needs no table lookups. The
+/// matrices of the skews below `n` are built once.
+template <typename TPolyEncoder> class BitslicedEngine final {
+public:
+  using Descriptor = typename TPolyEncoder::Descriptor;
+  using Word = bitsliced::Word;
+  using Matrix = bitsliced::Matrix;
+  static_assert(Descriptor::kFieldBits == 16ull,
+                "bit planes are laid out for GF(2^16)");
+
+  BitslicedEngine(const TPolyEncoder &poly_enc, size_t n)
+      : poly_enc_{poly_enc}, skews_(n) {
+    const auto &skews = poly_enc_.afft().skews;
+    for (size_t j = 0ull; j + 1ull < n; ++j)
+      skews_[j] = matrix(skews[j]);
+  }
+
+  /// Matrix of the multiplication by the constant of log `log`.
+  Matrix matrix(typename Descriptor::Multiplier log) const {
+    const auto &tables = poly_enc_.descriptor().kTables;
+    Matrix m{};
+    for (size_t c = 0ull; c < 16ull; ++c) {
+      const auto product =
+          Additive<Descriptor>{typename Descriptor::Elt(1ull << c)}
+              .mul(log, tables)
+              .point_0;
+      for (size_t r = 0ull; r < 16ull; ++r)
+        m.nibbles[r][c / 4ull] |=
+            uint8_t(((product >> r) & 1u) << (c % 4ull));
+    }
+    return m;
+  }
+
+  /// Same as `PolyEncoder::encodeParityLow`.
+  void encodeParity(Word *codeword, size_t k, size_t first, size_t last) const {
+    inverse(codeword, k, 0ull);
+    for (size_t shift = k; shift < last; shift += k) {
+      if (shift + k <= first)
+        continue;
+      memcpy(&codeword[shift], codeword, k * sizeof(Word));
+      forward(&codeword[shift], k, shift);
+    }
+  }
+
+  /// Same as `PolyEncoder::decode_main` over the prefix of `m` positions
+  /// recovering `[0, k)`. `error[i]` is the matrix of the error polynomial
+  /// at `i` and erased positions must hold zero.
+  void decode(Word *codeword, size_t m, size_t k,
+              const std::vector<bool> &present,
+              const std::vector<Matrix> &error) const {
+    for (size_t i = 0ull; i < m; ++i)
+      if (present[i])
+        mulInPlace(codeword[i], error[i]);
+
+    inverse(codeword, m, 0ull);
+    ec_cpp::formalDerivative(codeword, m, m);
+
+    for (size_t d = (m >> 1ull); d >= k && d > 0; d = (d >> 1ull))
+      if (!skip(d - 1ull))
+        for (size_t i = 0ull; i < d; ++i)
+          bitsliced::mulAdd(codeword[i], codeword[i + d], skews_[d - 1ull]);
+    forward(codeword, k, 0ull);
+
+    for (size_t i = 0ull; i < k; ++i)
+      if (!present[i])
+        mulInPlace(codeword[i], error[i]);
+  }
+
+private:
+  bool skip(size_t j) const {
+    return poly_enc_.afft().skews[j] == Descriptor::kOneMask;
+  }
+
+  static void mulInPlace(Word &w, const Matrix &m) {
+    Word product{};
+    bitsliced::mulAdd(product, w, m);
+    w = product;
+  }
+
+  void inverse(Word *data, size_t size, size_t index) const {
+    for (size_t d = 1ull; d < size; d = (d << 1ull))
+      for (size_t j = d; j < size; j += (d << 1ull)) {
+        const auto s = j + index - 1ull;
+        const auto skipped = skip(s);
+        for (size_t i = (j - d); i < j; ++i) {
+          bitsliced::xorAssign(data[i + d], data[i]);
+          if (!skipped)
+            bitsliced::mulAdd(data[i], data[i + d], skews_[s]);
+        }
+      }
+  }
+
+  void forward(Word *data, size_t size, size_t index) const {
+    for (size_t d = (size >> 1ull); d > 0; d = (d >> 1ull))
+      for (size_t j = d; j < size; j += (d << 1ull)) {
+        const auto s = j + index - 1ull;
+        const auto skipped = skip(s);
+        for (size_t i = (j - d); i < j; ++i) {
+          if (!skipped)
+            bitsliced::mulAdd(data[i], data[i + d], skews_[s]);
+          bitsliced::xorAssign(data[i + d], data[i]);
+        }
+      }
+  }
+
+  const TPolyEncoder &poly_enc_;
+  std::vector<Matrix> skews_;
+};
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_BITSLICED_HPP
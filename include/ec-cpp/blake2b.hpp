@@ -0,0 +1,311 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_BLAKE2B_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_BLAKE2B_HPP
+
+#include <array>
+#include <assert.h>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdlib.h>
+
+#include <ec-cpp/cpu.hpp>
+#include <ec-cpp/types.hpp>
+
+namespace ec_cpp {
+
+/// Unkeyed BLAKE2b (RFC 7693) with incremental input.
+class Blake2b final {
+public:
+  static constexpr size_t kBlockSize = 128ull;
+  static constexpr size_t kMaxDigestSize = 64ull;
+
+  /// The little-endian word at `p`, as BLAKE2b reads its message.
+  EC_CPP_ALWAYS_INLINE static uint64_t load64(const uint8_t *p) {
+    uint64_t r;
+    memcpy(&r, p, sizeof(r));
+    if constexpr (std::endian::native == std::endian::big)
+      r = __builtin_bswap64(r);
+    return r;
+  }
+
+  explicit Blake2b(size_t digest_size = 32ull) : digest_size_{digest_size} {
+    assert(digest_size_ > 0ull && digest_size_ <= kMaxDigestSize);
+    h_ = kIV;
+    h_[0] ^= 0x01010000ull ^ uint64_t(digest_size_);
+  }
+
+  void update(const uint8_t *data, size_t size) {
+    if (size == 0ull)
+      return;
+
+    /// The last block must stay buffered until `finalize`, it is compressed
+    /// with the final flag set.
+    const auto fill = kBlockSize - buffered_;
+    if (size > fill) {
+      memcpy(&buffer_[buffered_], data, fill);
+      compress(buffer_.data(), kBlockSize, false);
+      buffered_ = 0ull;
+      data += fill;
+      size -= fill;
+
+      while (size > kBlockSize) {
+        compress(data, kBlockSize, false);
+        data += kBlockSize;
+        size -= kBlockSize;
+      }
+    }
+    memcpy(&buffer_[buffered_], data, size);
+    buffered_ += size;
+  }
+
+  void update(Slice<const uint8_t> data) { update(data.data(), data.size()); }
+
+  void finalize(uint8_t *out) {
+    memset(&buffer_[buffered_], 0, kBlockSize - buffered_);
+    compress(buffer_.data(), buffered_, true);
+
+    uint8_t digest[kMaxDigestSize];
+    for (size_t i = 0ull; i < 8ull; ++i)
+      for (size_t b = 0ull; b < 8ull; ++b)
+        digest[i * 8ull + b] = uint8_t(h_[i] >> (8ull * b));
+    memcpy(out, digest, digest_size_);
+  }
+
+private:
+  static constexpr std::array<uint64_t, 8> kIV = {
+      0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull, 0x3c6ef372fe94f82bull,
+      0xa54ff53a5f1d36f1ull, 0x510e527fade682d1ull, 0x9b05688c2b3e6c1full,
+      0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull};
+
+  static constexpr uint8_t kSigma[12][16] = {
+      {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+      {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+      {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+      {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+      {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+      {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+      {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+      {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+      {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+      {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+      {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+      {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}};
+
+  static uint64_t rotr(uint64_t x, unsigned n) {
+    return (x >> n) | (x << (64u - n));
+  }
+
+  void compress(const uint8_t *block, size_t size, bool last) {
+    t_[0] += size;
+    if (t_[0] < size)
+      ++t_[1];
+
+    uint64_t m[16];
+    for (size_t i = 0ull; i < 16ull; ++i)
+      m[i] = load64(block + i * 8ull);
+
+    uint64_t v[16];
+    for (size_t i = 0ull; i < 8ull; ++i) {
+      v[i] = h_[i];
+      v[i + 8ull] = kIV[i];
+    }
+    v[12] ^= t_[0];
+    v[13] ^= t_[1];
+    if (last)
+      v[14] = ~v[14];
+
+    auto g = [&](size_t a, size_t b, size_t c, size_t d, uint64_t x,
+                 uint64_t y) {
+      v[a] = v[a] + v[b] + x;
+      v[d] = rotr(v[d] ^ v[a], 32u);
+      v[c] = v[c] + v[d];
+      v[b] = rotr(v[b] ^ v[c], 24u);
+      v[a] = v[a] + v[b] + y;
+      v[d] = rotr(v[d] ^ v[a], 16u);
+      v[c] = v[c] + v[d];
+      v[b] = rotr(v[b] ^ v[c], 63u);
+    };
+
+    for (size_t r = 0ull; r < 12ull; ++r) {
+      const auto *s = kSigma[r];
+      g(0, 4, 8, 12, m[s[0]], m[s[1]]);
+      g(1, 5, 9, 13, m[s[2]], m[s[3]]);
+      g(2, 6, 10, 14, m[s[4]], m[s[5]]);
+      g(3, 7, 11, 15, m[s[6]], m[s[7]]);
+      g(0, 5, 10, 15, m[s[8]], m[s[9]]);
+      g(1, 6, 11, 12, m[s[10]], m[s[11]]);
+      g(2, 7, 8, 13, m[s[12]], m[s[13]]);
+      g(3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (size_t i = 0ull; i < 8ull; ++i)
+      h_[i] ^= v[i] ^ v[i + 8ull];
+  }
+
+  std::array<uint64_t, 8> h_;
+  std::array<uint64_t, 2> t_ = {0ull, 0ull};
+  std::array<uint8_t, kBlockSize> buffer_ = {0};
+  size_t buffered_ = 0ull;
+  size_t digest_size_;
+};
+
+using Hash256 = std::array<uint8_t, 32>;
+
+namespace detail {
+
+/// Four BLAKE2b states side by side, one message per 64-bit lane.
+typedef uint64_t U64x4 __attribute__((vector_size(32)));
+
+EC_CPP_ALWAYS_INLINE void rotr4(U64x4 &x, unsigned n) {
+  x = (x >> n) | (x << (64u - n));
+}
+
+EC_CPP_ALWAYS_INLINE void g4(U64x4 *v, size_t a, size_t b, size_t c, size_t d,
+                             const U64x4 &x, const U64x4 &y) {
+  v[a] += v[b] + x;
+  v[d] ^= v[a];
+  rotr4(v[d], 32u);
+  v[c] += v[d];
+  v[b] ^= v[c];
+  rotr4(v[b], 24u);
+  v[a] += v[b] + y;
+  v[d] ^= v[a];
+  rotr4(v[d], 16u);
+  v[c] += v[d];
+  v[b] ^= v[c];
+  rotr4(v[b], 63u);
+}
+
+EC_CPP_ALWAYS_INLINE void compress4(U64x4 *h, const uint8_t *const *blocks,
+                                    uint64_t t, bool last) {
+  static constexpr uint64_t kIV[8] = {
+      0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull, 0x3c6ef372fe94f82bull,
+      0xa54ff53a5f1d36f1ull, 0x510e527fade682d1ull, 0x9b05688c2b3e6c1full,
+      0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull};
+  static constexpr uint8_t kSigma[12][16] = {
+      {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+      {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+      {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+      {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+      {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+      {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+      {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+      {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+      {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+      {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+      {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+      {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}};
+
+  U64x4 m[16];
+  for (size_t i = 0ull; i < 16ull; ++i)
+    m[i] = U64x4{Blake2b::load64(blocks[0] + i * 8ull),
+                 Blake2b::load64(blocks[1] + i * 8ull),
+                 Blake2b::load64(blocks[2] + i * 8ull),
+                 Blake2b::load64(blocks[3] + i * 8ull)};
+
+  U64x4 v[16];
+  for (size_t i = 0ull; i < 8ull; ++i) {
+    v[i] = h[i];
+    v[i + 8ull] = U64x4{kIV[i], kIV[i], kIV[i], kIV[i]};
+  }
+  v[12] ^= t;
+  if (last)
+    v[14] = ~v[14];
+
+  for (size_t r = 0ull; r < 12ull; ++r) {
+    const auto *s = kSigma[r];
+    g4(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+    g4(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+    g4(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+    g4(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+    g4(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+    g4(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+    g4(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+    g4(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+  }
+
+  for (size_t i = 0ull; i < 8ull; ++i)
+    h[i] ^= v[i] ^ v[i + 8ull];
+}
+
+EC_CPP_ALWAYS_INLINE void blake2b256x4(const uint8_t *const *in, size_t size,
+                                       Hash256 *out) {
+  constexpr uint64_t kIV0 = 0x6a09e667f3bcc908ull ^ 0x01010020ull;
+  U64x4 h[8] = {U64x4{kIV0, kIV0, kIV0, kIV0},
+                U64x4{0xbb67ae8584caa73bull, 0xbb67ae8584caa73bull,
+                      0xbb67ae8584caa73bull, 0xbb67ae8584caa73bull},
+                U64x4{0x3c6ef372fe94f82bull, 0x3c6ef372fe94f82bull,
+                      0x3c6ef372fe94f82bull, 0x3c6ef372fe94f82bull},
+                U64x4{0xa54ff53a5f1d36f1ull, 0xa54ff53a5f1d36f1ull,
+                      0xa54ff53a5f1d36f1ull, 0xa54ff53a5f1d36f1ull},
+                U64x4{0x510e527fade682d1ull, 0x510e527fade682d1ull,
+                      0x510e527fade682d1ull, 0x510e527fade682d1ull},
+                U64x4{0x9b05688c2b3e6c1full, 0x9b05688c2b3e6c1full,
+                      0x9b05688c2b3e6c1full, 0x9b05688c2b3e6c1full},
+                U64x4{0x1f83d9abfb41bd6bull, 0x1f83d9abfb41bd6bull,
+                      0x1f83d9abfb41bd6bull, 0x1f83d9abfb41bd6bull},
+                U64x4{0x5be0cd19137e2179ull, 0x5be0cd19137e2179ull,
+                      0x5be0cd19137e2179ull, 0x5be0cd19137e2179ull}};
+
+  size_t offset = 0ull;
+  const uint8_t *blocks[4];
+  while (size - offset > Blake2b::kBlockSize) {
+    for (size_t lane = 0ull; lane < 4ull; ++lane)
+      blocks[lane] = in[lane] + offset;
+    offset += Blake2b::kBlockSize;
+    compress4(h, blocks, offset, false);
+  }
+
+  uint8_t tail[4][Blake2b::kBlockSize] = {};
+  for (size_t lane = 0ull; lane < 4ull; ++lane) {
+    memcpy(tail[lane], in[lane] + offset, size - offset);
+    blocks[lane] = tail[lane];
+  }
+  compress4(h, blocks, size, true);
+
+  for (size_t lane = 0ull; lane < 4ull; ++lane)
+    for (size_t i = 0ull; i < 4ull; ++i)
+      for (size_t b = 0ull; b < 8ull; ++b)
+        out[lane][i * 8ull + b] = uint8_t(h[i][lane] >> (8ull * b));
+}
+
+EC_CPP_TARGET("avx2")
+inline void blake2b256x4Avx2(const uint8_t *const *in, size_t size,
+                             Hash256 *out) {
+  blake2b256x4(in, size, out);
+}
+
+inline void blake2b256x4Generic(const uint8_t *const *in, size_t size,
+                                Hash256 *out) {
+  blake2b256x4(in, size, out);
+}
+
+} // namespace detail
+
+/// BLAKE2b-256, the hash used for Polkadot chunk and trie node hashes.
+inline Hash256 blake2b_256(Slice<const uint8_t> data) {
+  Hash256 out;
+  Blake2b hasher(out.size());
+  hasher.update(data);
+  hasher.finalize(out.data());
+  return out;
+}
+
+/// BLAKE2b-256 of four messages of equal `size` at once. The four states
+/// share one set of vector registers, one message per lane.
+inline void blake2b_256_x4(const uint8_t *const in[4], size_t size,
+                           Hash256 out[4]) {
+  if (cpu::hasAvx2())
+    detail::blake2b256x4Avx2(in, size, out);
+  else
+    detail::blake2b256x4Generic(in, size, out);
+}
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_BLAKE2B_HPP
@@ -0,0 +1,53 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_CPU_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_CPU_HPP
+
+/// Kernels built for a specific instruction set are tagged with
+/// `EC_CPP_TARGET` and only called after the matching runtime check below.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define EC_CPP_X86_64 1
+#define EC_CPP_TARGET(isa) __attribute__((target(isa)))
+#else
+#define EC_CPP_X86_64 0
+#define EC_CPP_TARGET(isa)
+#endif
+
+#define EC_CPP_ALWAYS_INLINE inline __attribute__((always_inline))
+
+namespace ec_cpp::cpu {
+
+inline bool hasAvx2() {
+#if EC_CPP_X86_64
+  static const bool value = __builtin_cpu_supports("avx2");
+  return value;
+#else
+  return false;
+#endif
+}
+
+inline bool hasAvx512bw() {
+#if EC_CPP_X86_64
+  static const bool value = __builtin_cpu_supports("avx512f") &&
+                            __builtin_cpu_supports("avx512bw");
+  return value;
+#else
+  return false;
+#endif
+}
+
+inline bool hasPclmul() {
+#if EC_CPP_X86_64
+  static const bool value = __builtin_cpu_supports("pclmul");
+  return value;
+#else
+  return false;
+#endif
+}
+
+} // namespace ec_cpp::cpu
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_CPU_HPP
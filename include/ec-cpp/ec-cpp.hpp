@@ -6,18 +6,56 @@
 #ifndef NOVELPOLY_REED_SOLOMON_CRUST_EC_CPP_HPP
 #define NOVELPOLY_REED_SOLOMON_CRUST_EC_CPP_HPP
 
+#include <ec-cpp/availability_session.hpp>
+#include <ec-cpp/blake2b.hpp>
 #include <ec-cpp/errors.hpp>
 #include <ec-cpp/f2e16.hpp>
+#include <ec-cpp/f2e16_clmul.hpp>
+#include <ec-cpp/f2e8.hpp>
+#include <ec-cpp/file_codec.hpp>
 #include <ec-cpp/reed-solomon.hpp>
+#include <ec-cpp/shard_writer.hpp>
 
 namespace ec_cpp {
 
 using PolyEncoder_f2e16 = PolyEncoder<f2e16_Descriptor>;
+using PolyEncoder_f2e16_clmul = PolyEncoder<f2e16_ClmulDescriptor>;
+using PolyEncoder_f2e8 = PolyEncoder<f2e8_Descriptor>;
 
 /// Creates erasure-coding core.
 /// @param n_validators determines the number of validators to shard data for
+/// @param version codeword layout, see `CodeVersion`. `kV2` shards are
+/// `payload / k` long, `k` being the recovery threshold, where `kV1` ones
+/// divide by `k` rounded down to a power of two. Shards of the two versions
+/// do not interoperate
 ///
-Result<ReedSolomon<PolyEncoder_f2e16>> create(size_t n_validators);
+Result<ReedSolomon<PolyEncoder_f2e16>>
+create(size_t n_validators, CodeVersion version = CodeVersion::kV1);
+
+/// Same as `create`, with the transforms multiplying through carry-less
+/// multiplies instead of the log and exp tables. Shards are the same.
+/// @param n_validators determines the number of validators to shard data for
+/// @param version codeword layout, see `create`
+///
+Result<ReedSolomon<PolyEncoder_f2e16_clmul>>
+createClmul(size_t n_validators, CodeVersion version = CodeVersion::kV1);
+
+/// Same as `create` over GF(2^8), for at most 256 validators. Symbols are
+/// single bytes and every table fits in L1. Shards are not compatible with
+/// the GF(2^16) ones, and only the log/exp engine is available.
+/// @param n_validators determines the number of validators to shard data for
+/// @param version codeword layout, see `create`
+///
+Result<ReedSolomon<PolyEncoder_f2e8>>
+createF2e8(size_t n_validators, CodeVersion version = CodeVersion::kV1);
+
+/// Starts collecting the chunks of one payload for recovery.
+/// @param n_validators determines the number of validators to shard data for
+/// @param version codeword layout the chunks were encoded with
+///
+Result<AvailabilitySession<PolyEncoder_f2e16>>
+createAvailabilitySession(size_t n_validators,
+                          CodeVersion version = CodeVersion::kV1);
 
 /// Obtain a threshold of chunks that should be enough to recover the data.
 /// @param n_validators determines the number of validators to shard data for
@@ -25,6 +63,16 @@ Result<ReedSolomon<PolyEncoder_f2e16>> create(size_t n_validators);
 ///
 Result<size_t> getRecoveryThreshold(size_t n_validators);
 
+/// Compute the erasure root of a payload without keeping the shards.
+/// Meant for approval checks, where only the root of the re-encoded data is
+/// compared against the candidate receipt.
+/// @param payload data to be erasure-coded
+/// @param n_validators determines the number of validators to shard data for
+/// @return erasure root, as committed to by the candidate receipt
+///
+Result<Hash256> computeErasureRoot(Slice<uint8_t> payload,
+                                   size_t n_validators);
+
 } // namespace ec_cpp
 
 #endif // NOVELPOLY_REED_SOLOMON_CRUST_EC_CPP_HPP
@@ -0,0 +1,528 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_ERASURE_ROOT_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_ERASURE_ROOT_HPP
+
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <cstdint>
+#include <cstring>
+#include <stdlib.h>
+#include <unordered_map>
+#include <vector>
+
+#include <ec-cpp/blake2b.hpp>
+#include <ec-cpp/errors.hpp>
+#include <ec-cpp/thread_pool.hpp>
+#include <ec-cpp/types.hpp>
+
+namespace ec_cpp {
+
+/// Encoded trie nodes from the root down to a chunk leaf.
+using BranchProof = std::vector<std::vector<uint8_t>>;
+
+namespace trie {
+
+/// Substrate trie layout V0 node headers.
+constexpr uint8_t kEmptyTrie = 0x00;
+constexpr uint8_t kLeafPrefix = 0b01 << 6;
+constexpr uint8_t kBranchWithoutValue = 0b10 << 6;
+constexpr uint8_t kBranchWithValue = 0b11 << 6;
+constexpr uint8_t kPrefixMask = 0b11 << 6;
+
+/// Keys are `u32` chunk indices in SCALE (little-endian) encoding.
+constexpr size_t kKeyNibbles = 8ull;
+using Key = std::array<uint8_t, kKeyNibbles>;
+
+inline Key keyOf(size_t index) {
+  Key key;
+  for (size_t i = 0ull; i < 4ull; ++i) {
+    const auto byte = uint8_t(index >> (8ull * i));
+    key[2ull * i] = byte >> 4;
+    key[2ull * i + 1ull] = byte & 0x0f;
+  }
+  return key;
+}
+
+inline void encodeCompact(std::vector<uint8_t> &out, size_t value) {
+  if (value < (1ull << 6)) {
+    out.push_back(uint8_t(value << 2));
+  } else if (value < (1ull << 14)) {
+    const auto v = (value << 2) | 0b01;
+    out.push_back(uint8_t(v));
+    out.push_back(uint8_t(v >> 8));
+  } else {
+    assert(value < (1ull << 30));
+    const auto v = (value << 2) | 0b10;
+    for (size_t i = 0ull; i < 4ull; ++i)
+      out.push_back(uint8_t(v >> (8ull * i)));
+  }
+}
+
+inline void encodeHeader(std::vector<uint8_t> &out, uint8_t prefix,
+                         size_t nibbles) {
+  constexpr size_t kMaxValue = 63ull;
+  if (nibbles < kMaxValue) {
+    out.push_back(uint8_t(prefix | nibbles));
+    return;
+  }
+  out.push_back(uint8_t(prefix | kMaxValue));
+  auto rem = nibbles - (kMaxValue - 1ull);
+  while (rem >= 256ull) {
+    out.push_back(255);
+    rem -= 255ull;
+  }
+  out.push_back(uint8_t(rem - 1ull));
+}
+
+inline void encodePartial(std::vector<uint8_t> &out, const uint8_t *nibbles,
+                          size_t count) {
+  size_t i = 0ull;
+  if (count % 2ull == 1ull)
+    out.push_back(nibbles[i++]);
+  for (; i < count; i += 2ull)
+    out.push_back(uint8_t((nibbles[i] << 4) | nibbles[i + 1ull]));
+}
+
+/// Reference to a child node: its hash, or the node itself when the
+/// encoding is shorter than a hash.
+inline void encodeChildRef(std::vector<uint8_t> &out,
+                           const std::vector<uint8_t> &child) {
+  if (child.size() < sizeof(Hash256)) {
+    encodeCompact(out, child.size());
+    out.insert(out.end(), child.begin(), child.end());
+  } else {
+    const auto hash = blake2b_256(child);
+    encodeCompact(out, hash.size());
+    out.insert(out.end(), hash.begin(), hash.end());
+  }
+}
+
+/// Bounded reader over an encoded node.
+struct Reader {
+  Slice<const uint8_t> data;
+  size_t pos = 0ull;
+
+  bool take(size_t count, Slice<const uint8_t> &out) {
+    if (data.size() - pos < count)
+      return false;
+    out = data.subspan(pos, count);
+    pos += count;
+    return true;
+  }
+
+  bool byte(uint8_t &out) {
+    if (pos >= data.size())
+      return false;
+    out = data[pos++];
+    return true;
+  }
+
+  bool compact(size_t &out) {
+    uint8_t b0;
+    if (!byte(b0))
+      return false;
+
+    size_t len = 0ull;
+    switch (b0 & 0b11) {
+    case 0b00:
+      out = b0 >> 2;
+      return true;
+    case 0b01:
+      len = 2ull;
+      break;
+    case 0b10:
+      len = 4ull;
+      break;
+    default:
+      len = (b0 >> 2) + 4ull;
+      if (len > 8ull)
+        return false;
+      out = 0ull;
+      for (size_t i = 0ull; i < len; ++i) {
+        uint8_t b;
+        if (!byte(b))
+          return false;
+        out |= size_t(b) << (8ull * i);
+      }
+      return true;
+    }
+
+    out = b0;
+    for (size_t i = 1ull; i < len; ++i) {
+      uint8_t b;
+      if (!byte(b))
+        return false;
+      out |= size_t(b) << (8ull * i);
+    }
+    out >>= 2;
+    return true;
+  }
+
+  bool nibbleCount(uint8_t header, size_t &out) {
+    constexpr size_t kMaxValue = 63ull;
+    out = header & kMaxValue;
+    if (out < kMaxValue)
+      return true;
+
+    --out;
+    for (;;) {
+      uint8_t b;
+      if (!byte(b))
+        return false;
+      if (b < 255) {
+        out += size_t(b) + 1ull;
+        return true;
+      }
+      out += 255ull;
+    }
+  }
+
+  bool partial(size_t count, std::vector<uint8_t> &nibbles) {
+    Slice<const uint8_t> bytes;
+    if (!take((count + 1ull) / 2ull, bytes))
+      return false;
+
+    nibbles.clear();
+    size_t i = 0ull;
+    if (count % 2ull == 1ull) {
+      if ((bytes[0] & 0xf0) != 0)
+        return false;
+      nibbles.push_back(bytes[i++]);
+    }
+    for (; i < bytes.size(); ++i) {
+      nibbles.push_back(bytes[i] >> 4);
+      nibbles.push_back(bytes[i] & 0x0f);
+    }
+    return true;
+  }
+};
+
+} // namespace trie
+
+/// BLAKE2b-256 of `count` chunks, `chunk_of(i)` giving chunk `i`, hashed on
+/// `pool`. Chunks of equal length go through the four-lane kernel together.
+template <typename ChunkOf>
+std::vector<Hash256> hashChunks(size_t count, const ChunkOf &chunk_of,
+                                ThreadPool &pool) {
+  std::vector<size_t> order(count);
+  for (size_t i = 0ull; i < count; ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return chunk_of(a).size() < chunk_of(b).size();
+  });
+
+  std::vector<Hash256> hashes(count);
+  pool.parallelFor((count + 3) / 4, [&](size_t begin, size_t end) {
+    for (size_t q = begin; q < end; ++q) {
+      const auto *idx = &order[q * 4ull];
+      const auto lanes = std::min(count - q * 4, size_t(4ull));
+      const auto size = chunk_of(idx[0]).size();
+      if (lanes == 4ull && chunk_of(idx[3]).size() == size) {
+        const uint8_t *in[4];
+        Hash256 out[4];
+        for (size_t lane = 0ull; lane < 4ull; ++lane)
+          in[lane] = chunk_of(idx[lane]).data();
+        blake2b_256_x4(in, size, out);
+        for (size_t lane = 0ull; lane < 4ull; ++lane)
+          hashes[idx[lane]] = out[lane];
+      } else {
+        for (size_t lane = 0ull; lane < lanes; ++lane)
+          hashes[idx[lane]] = blake2b_256(chunk_of(idx[lane]));
+      }
+    }
+  });
+  return hashes;
+}
+
+/// Merkle trie committing to the chunks of an erasure-coded payload, laid
+/// out as the Polkadot erasure root: a Substrate (layout V0) Patricia trie
+/// mapping each SCALE-encoded `u32` chunk index to the BLAKE2b-256 hash of
+/// the chunk.
+class ErasureTrie final {
+public:
+  explicit ErasureTrie(std::vector<Hash256> chunk_hashes)
+      : chunk_hashes_{std::move(chunk_hashes)} {
+    if (chunk_hashes_.empty()) {
+      const uint8_t empty[] = {trie::kEmptyTrie};
+      root_ = blake2b_256(empty);
+      return;
+    }
+
+    std::vector<std::pair<trie::Key, size_t>> keys;
+    keys.reserve(chunk_hashes_.size());
+    for (size_t i = 0ull; i < chunk_hashes_.size(); ++i)
+      keys.emplace_back(trie::keyOf(i), i);
+    std::sort(keys.begin(), keys.end());
+
+    nodes_.reserve(chunk_hashes_.size() * 2ull);
+    build(keys.data(), keys.size(), 0ull);
+    root_ = blake2b_256(nodes_.back().encoded);
+  }
+
+  /// Hashes `chunks` in parallel across `pool` and builds the trie.
+  template <typename Chunk>
+  static ErasureTrie fromChunks(const std::vector<Chunk> &chunks,
+                                ThreadPool &pool = ThreadPool::shared()) {
+    return ErasureTrie{hashChunks(
+        chunks.size(),
+        [&](size_t i) {
+          return Slice<const uint8_t>{chunks[i].data(), chunks[i].size()};
+        },
+        pool)};
+  }
+
+  const Hash256 &root() const { return root_; }
+
+  size_t size() const { return chunk_hashes_.size(); }
+
+  const Hash256 &chunkHash(size_t index) const {
+    assert(index < chunk_hashes_.size());
+    return chunk_hashes_[index];
+  }
+
+  /// Proof that chunk `index` is committed to by `root()`.
+  Result<BranchProof> branch(size_t index) const {
+    if (index >= chunk_hashes_.size())
+      return Error::kBranchOutOfBounds;
+
+    const auto key = trie::keyOf(index);
+    BranchProof proof;
+    auto node = nodes_.size() - 1ull;
+    for (;;) {
+      proof.push_back(nodes_[node].encoded);
+      const auto depth = nodes_[node].depth;
+      if (depth == trie::kKeyNibbles)
+        break;
+      node = nodes_[node].children[key[depth]];
+    }
+    return proof;
+  }
+
+private:
+  struct Node {
+    std::vector<uint8_t> encoded;
+    /// Key nibbles consumed below this node, `kKeyNibbles` for a leaf.
+    size_t depth;
+    std::array<size_t, 16> children;
+  };
+
+  size_t build(const std::pair<trie::Key, size_t> *keys, size_t count,
+               size_t depth) {
+    Node node;
+    const auto &first = keys[0].first;
+    if (count == 1ull) {
+      trie::encodeHeader(node.encoded, trie::kLeafPrefix,
+                         trie::kKeyNibbles - depth);
+      trie::encodePartial(node.encoded, &first[depth],
+                          trie::kKeyNibbles - depth);
+      const auto &hash = chunk_hashes_[keys[0].second];
+      trie::encodeCompact(node.encoded, hash.size());
+      node.encoded.insert(node.encoded.end(), hash.begin(), hash.end());
+      node.depth = trie::kKeyNibbles;
+      nodes_.push_back(std::move(node));
+      return nodes_.size() - 1ull;
+    }
+
+    const auto &last = keys[count - 1ull].first;
+    auto split = depth;
+    while (first[split] == last[split])
+      ++split;
+
+    node.depth = split;
+    node.children.fill(0ull);
+    uint16_t bitmap = 0;
+    std::array<std::pair<size_t, size_t>, 16> groups{};
+    for (size_t i = 0ull; i < count;) {
+      const auto nibble = keys[i].first[split];
+      auto j = i;
+      while (j < count && keys[j].first[split] == nibble)
+        ++j;
+      groups[nibble] = {i, j - i};
+      bitmap |= uint16_t(1u << nibble);
+      i = j;
+    }
+
+    for (size_t nibble = 0ull; nibble < 16ull; ++nibble)
+      if ((bitmap >> nibble) & 1u)
+        node.children[nibble] = build(keys + groups[nibble].first,
+                                      groups[nibble].second, split + 1ull);
+
+    trie::encodeHeader(node.encoded, trie::kBranchWithoutValue,
+                       split - depth);
+    trie::encodePartial(node.encoded, &first[depth], split - depth);
+    node.encoded.push_back(uint8_t(bitmap));
+    node.encoded.push_back(uint8_t(bitmap >> 8));
+    for (size_t nibble = 0ull; nibble < 16ull; ++nibble)
+      if ((bitmap >> nibble) & 1u)
+        trie::encodeChildRef(node.encoded,
+                             nodes_[node.children[nibble]].encoded);
+
+    nodes_.push_back(std::move(node));
+    return nodes_.size() - 1ull;
+  }
+
+  std::vector<Hash256> chunk_hashes_;
+  std::vector<Node> nodes_;
+  Hash256 root_;
+};
+
+/// Checks `proof` against `root` and returns the chunk hash it commits to
+/// at `index`. Mirrors Polkadot's `branch_hash`.
+inline Result<Hash256> branchHash(const Hash256 &root, const BranchProof &proof,
+                                  size_t index) {
+  struct HashOf {
+    size_t operator()(const Hash256 &h) const {
+      size_t r;
+      memcpy(&r, h.data(), sizeof(r));
+      return r;
+    }
+  };
+  std::unordered_map<Hash256, Slice<const uint8_t>, HashOf> db;
+  for (const auto &node : proof)
+    db.emplace(blake2b_256(node), Slice<const uint8_t>{node});
+
+  const auto key = trie::keyOf(index);
+  size_t consumed = 0ull;
+  std::vector<uint8_t> partial;
+
+  auto node_it = db.find(root);
+  if (node_it == db.end())
+    return Error::kInvalidBranchProof;
+  Slice<const uint8_t> node = node_it->second;
+
+  for (;;) {
+    trie::Reader r{node};
+    uint8_t header;
+    if (!r.byte(header))
+      return Error::kInvalidBranchProof;
+    if (header == trie::kEmptyTrie)
+      return Error::kBranchOutOfBounds;
+
+    const auto kind = header & trie::kPrefixMask;
+    if (kind == 0)
+      return Error::kInvalidBranchProof;
+
+    size_t nibbles;
+    if (!r.nibbleCount(header, nibbles) || !r.partial(nibbles, partial))
+      return Error::kInvalidBranchProof;
+
+    const auto matches =
+        partial.size() <= trie::kKeyNibbles - consumed &&
+        std::equal(partial.begin(), partial.end(), key.data() + consumed);
+
+    auto read_value = [&](Slice<const uint8_t> &value) {
+      size_t len;
+      return r.compact(len) && r.take(len, value);
+    };
+
+    if (kind == trie::kLeafPrefix) {
+      Slice<const uint8_t> value;
+      if (!read_value(value))
+        return Error::kInvalidBranchProof;
+      if (!matches || consumed + partial.size() != trie::kKeyNibbles)
+        return Error::kBranchOutOfBounds;
+      if (value.size() < sizeof(Hash256))
+        return Error::kInvalidBranchProof;
+
+      Hash256 hash;
+      memcpy(hash.data(), value.data(), hash.size());
+      return hash;
+    }
+
+    uint8_t bitmap_bytes[2];
+    if (!r.byte(bitmap_bytes[0]) || !r.byte(bitmap_bytes[1]))
+      return Error::kInvalidBranchProof;
+    const auto bitmap = uint16_t(bitmap_bytes[0] | (bitmap_bytes[1] << 8));
+    if (bitmap == 0)
+      return Error::kInvalidBranchProof;
+
+    if (kind == trie::kBranchWithValue) {
+      Slice<const uint8_t> value;
+      if (!read_value(value))
+        return Error::kInvalidBranchProof;
+    }
+    if (!matches)
+      return Error::kBranchOutOfBounds;
+
+    consumed += partial.size();
+    if (consumed == trie::kKeyNibbles)
+      return Error::kBranchOutOfBounds;
+
+    const auto nibble = key[consumed++];
+    if (((bitmap >> nibble) & 1u) == 0)
+      return Error::kBranchOutOfBounds;
+
+    Slice<const uint8_t> child;
+    for (size_t i = 0ull; i <= nibble; ++i) {
+      if (((bitmap >> i) & 1u) == 0)
+        continue;
+      size_t len;
+      if (!r.compact(len) || !r.take(len, child))
+        return Error::kInvalidBranchProof;
+    }
+
+    if (child.size() == sizeof(Hash256)) {
+      Hash256 child_hash;
+      memcpy(child_hash.data(), child.data(), child_hash.size());
+      node_it = db.find(child_hash);
+      if (node_it == db.end())
+        return Error::kInvalidBranchProof;
+      node = node_it->second;
+    } else {
+      node = child;
+    }
+  }
+}
+
+/// A received chunk together with the branch proof and erasure root it is
+/// claimed to belong to.
+struct ChunkBranch {
+  Slice<const uint8_t> chunk;
+  size_t index;
+  const BranchProof *proof;
+  const Hash256 *root;
+};
+
+/// Checks a batch of received chunks on `pool`. Entry `i` of the result is
+/// set when `batch[i].proof` leads from `batch[i].root` to the leaf of
+/// `batch[i].index` and that leaf holds the hash of `batch[i].chunk`.
+inline std::vector<bool> verifyBranches(Slice<const ChunkBranch> batch,
+                                        ThreadPool &pool = ThreadPool::shared()) {
+  const auto hashes = hashChunks(
+      batch.size(), [&](size_t i) { return batch[i].chunk; }, pool);
+
+  std::vector<uint8_t> valid(batch.size(), 0u);
+  pool.parallelFor(batch.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      auto leaf = branchHash(*batch[i].root, *batch[i].proof, batch[i].index);
+      valid[i] = !resultHasError(leaf) &&
+                 resultGetValue(std::move(leaf)) == hashes[i];
+    }
+  });
+  return {valid.begin(), valid.end()};
+}
+
+/// Arranges the chunks that passed `verifyBranches` by index into `n`
+/// shards, the layout `ReedSolomon::reconstruct` takes. Missing or rejected
+/// chunks stay empty and count as erasures.
+inline std::vector<std::vector<uint8_t>>
+verifiedShards(Slice<const ChunkBranch> batch, const std::vector<bool> &valid,
+               size_t n) {
+  assert(valid.size() == batch.size());
+  std::vector<std::vector<uint8_t>> shards(n);
+  for (size_t i = 0ull; i < batch.size(); ++i) {
+    const auto &c = batch[i];
+    if (valid[i] && c.index < n && shards[c.index].empty())
+      shards[c.index].assign(c.chunk.begin(), c.chunk.end());
+  }
+  return shards;
+}
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_ERASURE_ROOT_HPP
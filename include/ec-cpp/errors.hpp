@@ -21,6 +21,15 @@ enum struct Error {
   kNeedMoreShards,
   kInconsistentShardLengths,
   kEmptyShard,
+  kInvalidBranchProof,
+  kBranchOutOfBounds,
+  kTooManyCorruptedShards,
+  kChunkIndexOutOfRange,
+  kDuplicateChunk,
+  kOutputTooLong,
+  kUpdateLengthMismatch,
+  kUpdateOutOfRange,
+  kIoError,
 };
 
 template <typename T> using Result = std::variant<T, Error>;
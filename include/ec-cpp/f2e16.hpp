@@ -15,6 +15,7 @@
 
 #include <ec-cpp/additive_fft.hpp>
 #include <ec-cpp/errors.hpp>
+#include <ec-cpp/field_tables.hpp>
 #include <ec-cpp/math.hpp>
 #include <ec-cpp/poly_encoder.hpp>
 #include <ec-cpp/types.hpp>
@@ -45,43 +46,7 @@ struct f2e16_Descriptor {
   using Tables =
       std::tuple<std::array<Elt, kFieldSize>, std::array<Elt, kFieldSize>,
                  std::array<Multiplier, kFieldSize>>;
-  const Tables kTables = []() {
-    std::array<Elt, kFieldSize> log_table = {0};
-    std::array<Elt, kFieldSize> exp_table = {0};
-
-    const Elt mas = (1 << (kFieldBits - 1)) - 1;
-    size_t state = 1ull;
-    for (size_t i = 0ull; i < size_t(kOneMask); ++i) {
-      exp_table[state] = Elt(i);
-      if ((state >> (kFieldBits - 1)) != 0) {
-        state &= size_t(mas);
-        state = (state << 1ull) ^ size_t(kGenerator);
-      } else
-        state = (state << 1ull);
-    }
-
-    exp_table[0] = kOneMask;
-    log_table[0] = 0;
-
-    for (size_t i = 0ull; i < kFieldBits; ++i)
-      for (size_t j = 0ull; j < (1ull << i); ++j)
-        log_table[j + (1ull << i)] = log_table[j] ^ kBase[i];
-
-    for (size_t i = 0ull; i < kFieldSize; ++i)
-      log_table[i] = exp_table[size_t(log_table[i])];
-
-    for (size_t i = 0ull; i < kFieldSize; ++i)
-      exp_table[size_t(log_table[i])] = Elt(i);
-
-    exp_table[size_t(kOneMask)] = exp_table[0];
-
-    std::array<Multiplier, kFieldSize> log_walsh{log_table};
-    log_walsh[0] = 0;
-    walsh<f2e16_Descriptor>(log_walsh);
-
-    return std::make_tuple(std::move(log_table), std::move(exp_table),
-                           std::move(log_walsh));
-  }();
+  const Tables kTables = fieldTables<f2e16_Descriptor>();
 
   static Elt fromBEBytes(const uint8_t *data) {
     return Elt(Elt(Elt(*data) << 8) | Elt(*(data + 1)));
@@ -0,0 +1,189 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_F2E16_CLMUL_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_F2E16_CLMUL_HPP
+
+#include <array>
+#include <cstdint>
+#include <stdlib.h>
+#include <type_traits>
+
+#include <ec-cpp/cpu.hpp>
+#include <ec-cpp/f2e16.hpp>
+
+#if EC_CPP_X86_64
+#include <immintrin.h>
+#endif
+
+namespace ec_cpp {
+
+namespace detail {
+
+/// A linear map of 16-bit symbols as four tables of sixteen entries, one
+/// per nibble of the argument.
+using NibbleTables = std::array<std::array<uint16_t, 16>, 4>;
+
+/// Tables of the map sending bit `i` to `image[i]`.
+constexpr NibbleTables nibbleTables(const std::array<uint16_t, 16> &image) {
+  NibbleTables t{};
+  for (size_t g = 0ull; g < 4ull; ++g)
+    for (size_t v = 0ull; v < 16ull; ++v)
+      for (size_t b = 0ull; b < 4ull; ++b)
+        if ((v >> b) & 1ull)
+          t[g][v] ^= image[g * 4ull + b];
+  return t;
+}
+
+} // namespace detail
+
+/// Same field and symbol representation as `f2e16_Descriptor`, but products
+/// are computed with a carry-less multiply and a Barrett reduction instead
+/// of the log and exp tables.
+///
+/// Symbols keep the Cantor-basis representation of the wire format. A
+/// product converts the symbol to the polynomial basis of
+/// `x^16 + x^5 + x^3 + x^2 + 1`, multiplies and reduces there, and converts
+/// back, each conversion being four nibble lookups. The whole product path
+/// reads 256 bytes of tables. The log and exp tables are still built: the
+/// setup and the error polynomial work on logs, and a multiplier is turned
+/// into a `Constant` through them, which the transforms do once per skew
+/// group and the decode once per symbol, never per product.
+///
+/// The multiply is picked once per transform: `withKernel` hands it the
+/// `Kernel` using `pclmulqdq` where the CPU has it.
+struct f2e16_ClmulDescriptor : f2e16_Descriptor {
+  /// A multiplier prepared for `mulConstant`: the constant in the
+  /// polynomial basis.
+  using Constant = Elt;
+
+  static constexpr uint32_t kPoly = 0x1002Du;
+
+  /// `x^32 / kPoly`, the Barrett constant.
+  static constexpr uint32_t kBarrett = [] {
+    uint64_t quotient = 0ull, rest = 1ull << 32ull;
+    for (size_t bit = 17ull; bit-- > 0ull;)
+      if ((rest >> (bit + 16ull)) & 1ull) {
+        quotient |= 1ull << bit;
+        rest ^= uint64_t(kPoly) << bit;
+      }
+    return uint32_t(quotient);
+  }();
+
+  using NibbleTables = detail::NibbleTables;
+
+  /// Cantor basis to polynomial basis: bit `i` stands for `kBase[i]`.
+  static constexpr NibbleTables kToPoly = [] {
+    std::array<Elt, 16> image{};
+    for (size_t i = 0ull; i < 16ull; ++i)
+      image[i] = kBase[i];
+    return detail::nibbleTables(image);
+  }();
+
+  /// Polynomial basis to Cantor basis, by Gauss-Jordan elimination of the
+  /// basis.
+  static constexpr NibbleTables kFromPoly = [] {
+    std::array<Elt, 16> poly{}, cantor{};
+    for (size_t i = 0ull; i < 16ull; ++i) {
+      poly[i] = kBase[i];
+      cantor[i] = Elt(1u << i);
+    }
+    for (size_t c = 0ull; c < 16ull; ++c) {
+      size_t p = c;
+      while (((poly[p] >> c) & 1u) == 0u)
+        ++p;
+      std::swap(poly[p], poly[c]);
+      std::swap(cantor[p], cantor[c]);
+      for (size_t r = 0ull; r < 16ull; ++r)
+        if (r != c && ((poly[r] >> c) & 1u)) {
+          poly[r] ^= poly[c];
+          cantor[r] ^= cantor[c];
+        }
+    }
+    return detail::nibbleTables(cantor);
+  }();
+
+  static Elt convert(Elt x, const NibbleTables &t) {
+    return t[0][x & 0xf] ^ t[1][(x >> 4) & 0xf] ^ t[2][(x >> 8) & 0xf] ^
+           t[3][x >> 12];
+  }
+
+  static Constant constant(Multiplier log, const Tables &tables) {
+    return convert(std::get<1>(tables)[size_t(log)], kToPoly);
+  }
+
+  /// `mulConstant` with the multiply fixed, for the transforms.
+  template <bool Pclmul> struct Kernel {
+    EC_CPP_ALWAYS_INLINE static Elt mulConstant(Elt x, Constant c) {
+      const auto a = convert(x, kToPoly);
+      if constexpr (Pclmul)
+        return convert(mulPolyPclmul(a, c), kFromPoly);
+      else
+        return convert(mulPolyGeneric(a, c), kFromPoly);
+    }
+  };
+
+  /// Calls `f(std::type_identity<Kernel<...>>{})` with the kernel of this
+  /// CPU.
+  template <typename F> static decltype(auto) withKernel(const F &f) {
+#if EC_CPP_X86_64 && !defined(__PCLMUL__)
+    if (!cpu::hasPclmul())
+      return f(std::type_identity<Kernel<false>>{});
+#endif
+    return f(std::type_identity<Kernel<bool(EC_CPP_X86_64)>>{});
+  }
+
+  static Elt mulConstant(Elt x, Constant c) {
+    return withKernel([&](auto kernel) {
+      return decltype(kernel)::type::mulConstant(x, c);
+    });
+  }
+
+  /// Product in the polynomial basis, reduced the Barrett way:
+  /// `q = ((p >> 16) * kBarrett) >> 16`, `p + q * kPoly`.
+  EC_CPP_ALWAYS_INLINE static Elt mulPolyGeneric(Elt a, Elt b) {
+    const auto p = clmul(a, b);
+    const auto q = clmul(p >> 16u, kBarrett) >> 16u;
+    return Elt(p ^ clmul(q, kPoly));
+  }
+
+#if EC_CPP_X86_64
+  /// `mulPolyGeneric` with `pclmulqdq`, to be called only where the CPU has
+  /// it. The instruction is written out rather than taken from its
+  /// intrinsic, which would need the `pclmul` target on every function it
+  /// is inlined into, up to the transform loops.
+  EC_CPP_ALWAYS_INLINE static Elt mulPolyPclmul(Elt a, Elt b) {
+    const auto p = clmulLow(_mm_cvtsi32_si128(a), _mm_cvtsi32_si128(b));
+    const auto q = _mm_srli_epi64(
+        clmulLow(_mm_srli_epi64(p, 16), _mm_cvtsi32_si128(int(kBarrett))),
+        16);
+    const auto r =
+        _mm_xor_si128(p, clmulLow(q, _mm_cvtsi32_si128(int(kPoly))));
+    return Elt(_mm_cvtsi128_si32(r));
+  }
+#else
+  static Elt mulPolyPclmul(Elt a, Elt b) { return mulPolyGeneric(a, b); }
+#endif
+
+private:
+#if EC_CPP_X86_64
+  /// Carry-less product of the low 64-bit halves.
+  EC_CPP_ALWAYS_INLINE static __m128i clmulLow(__m128i a, __m128i b) {
+    asm("pclmulqdq {$0x00, %1, %0|%0, %1, 0x00}" : "+x"(a) : "xm"(b));
+    return a;
+  }
+#endif
+
+  EC_CPP_ALWAYS_INLINE static uint64_t clmul(uint64_t a, uint64_t b) {
+    uint64_t r = 0ull;
+    for (size_t i = 0ull; i < 17ull; ++i)
+      r ^= (a << i) & (0ull - ((b >> i) & 1ull));
+    return r;
+  }
+};
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_F2E16_CLMUL_HPP
@@ -0,0 +1,52 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_F2E8_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_F2E8_HPP
+
+#include <array>
+#include <cstdint>
+#include <stdlib.h>
+#include <tuple>
+
+#include <ec-cpp/field_tables.hpp>
+
+namespace ec_cpp {
+
+/// GF(2^8) for codes of up to 256 shards. Symbols are single bytes, so the
+/// wire format has no byte order, and the three tables take 768 bytes and
+/// stay in L1 along with the 256-entry error polynomial.
+struct f2e8_Descriptor {
+  /// @brief element type of the field
+  using Elt = uint8_t;
+  using Wide = uint16_t;
+  using Multiplier = Elt;
+
+  static constexpr size_t kFieldBits = 8ull;
+  static constexpr size_t kFieldSize = (1ull << kFieldBits);
+
+  static constexpr Elt kGenerator = 0x1D;
+  static constexpr Elt kOneMask = Elt(kFieldSize - 1ull);
+  static constexpr Elt kBase[kFieldBits] = {1,   214, 152, 146,
+                                            86,  200, 88,  230};
+
+  /**
+   * kLogTable = 0
+   * kExpTable = 1
+   * kLogWalsh = 2
+   */
+  using Tables =
+      std::tuple<std::array<Elt, kFieldSize>, std::array<Elt, kFieldSize>,
+                 std::array<Multiplier, kFieldSize>>;
+  const Tables kTables = fieldTables<f2e8_Descriptor>();
+
+  static Elt fromBEBytes(const uint8_t *data) { return *data; }
+
+  static void toBEBytes(uint8_t *dst, Elt src) { dst[0] = src; }
+};
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_F2E8_HPP
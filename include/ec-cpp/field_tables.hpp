@@ -0,0 +1,68 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_FIELD_TABLES_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_FIELD_TABLES_HPP
+
+#include <array>
+#include <cstdint>
+#include <stdlib.h>
+#include <tuple>
+
+#include <ec-cpp/walsh.hpp>
+
+namespace ec_cpp {
+
+/// Log, exp and Walsh transformed log tables of the field of `TDescriptor`,
+/// symbols being written in its Cantor basis `kBase` and logs taken to the
+/// root of `x^kFieldBits + kGenerator`.
+template <typename TDescriptor>
+typename TDescriptor::Tables fieldTables() {
+  using Elt = typename TDescriptor::Elt;
+  using Multiplier = typename TDescriptor::Multiplier;
+  constexpr auto kFieldBits = TDescriptor::kFieldBits;
+  constexpr auto kFieldSize = TDescriptor::kFieldSize;
+  constexpr auto kOneMask = TDescriptor::kOneMask;
+
+  std::array<Elt, kFieldSize> log_table = {0};
+  std::array<Elt, kFieldSize> exp_table = {0};
+
+  const Elt mas = (1 << (kFieldBits - 1)) - 1;
+  size_t state = 1ull;
+  for (size_t i = 0ull; i < size_t(kOneMask); ++i) {
+    exp_table[state] = Elt(i);
+    if ((state >> (kFieldBits - 1)) != 0) {
+      state &= size_t(mas);
+      state = (state << 1ull) ^ size_t(TDescriptor::kGenerator);
+    } else
+      state = (state << 1ull);
+  }
+
+  exp_table[0] = kOneMask;
+  log_table[0] = 0;
+
+  for (size_t i = 0ull; i < kFieldBits; ++i)
+    for (size_t j = 0ull; j < (1ull << i); ++j)
+      log_table[j + (1ull << i)] = log_table[j] ^ TDescriptor::kBase[i];
+
+  for (size_t i = 0ull; i < kFieldSize; ++i)
+    log_table[i] = exp_table[size_t(log_table[i])];
+
+  for (size_t i = 0ull; i < kFieldSize; ++i)
+    exp_table[size_t(log_table[i])] = Elt(i);
+
+  exp_table[size_t(kOneMask)] = exp_table[0];
+
+  std::array<Multiplier, kFieldSize> log_walsh{log_table};
+  log_walsh[0] = 0;
+  walsh<TDescriptor>(log_walsh);
+
+  return std::make_tuple(std::move(log_table), std::move(exp_table),
+                         std::move(log_walsh));
+}
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_FIELD_TABLES_HPP
@@ -0,0 +1,320 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_FILE_CODEC_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_FILE_CODEC_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <future>
+#include <stdlib.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <ec-cpp/errors.hpp>
+#include <ec-cpp/reed-solomon.hpp>
+#include <ec-cpp/types.hpp>
+
+namespace ec_cpp {
+
+namespace detail {
+
+/// Owns a file descriptor.
+class FileHandle final {
+public:
+  FileHandle() = default;
+  explicit FileHandle(int fd) : fd_{fd} {}
+  FileHandle(FileHandle &&other) noexcept
+      : fd_{std::exchange(other.fd_, -1)} {}
+  FileHandle &operator=(FileHandle &&other) noexcept {
+    std::swap(fd_, other.fd_);
+    return *this;
+  }
+  ~FileHandle() {
+    if (fd_ >= 0)
+      ::close(fd_);
+  }
+
+  int get() const { return fd_; }
+
+  explicit operator bool() const { return fd_ >= 0; }
+
+  /// Writes all of `[data, data + size)` at `offset`.
+  bool writeAll(const uint8_t *data, size_t size, size_t offset) const {
+    while (size != 0ull) {
+      const auto written = ::pwrite(fd_, data, size, off_t(offset));
+      if (written < 0 && errno == EINTR)
+        continue;
+      if (written <= 0)
+        return false;
+      data += written;
+      size -= size_t(written);
+      offset += size_t(written);
+    }
+    return true;
+  }
+
+private:
+  int fd_ = -1;
+};
+
+/// A whole file mapped read-only. Its pages are read in ahead of use with
+/// `prefetch` and dropped after it with `release`, so the resident part of
+/// the mapping follows the window being worked on.
+class MappedFile final {
+public:
+  MappedFile() = default;
+  MappedFile(MappedFile &&other) noexcept
+      : data_{std::exchange(other.data_, nullptr)},
+        size_{std::exchange(other.size_, 0ull)} {}
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+  ~MappedFile() {
+    if (data_)
+      ::munmap(data_, size_);
+  }
+
+  static Result<MappedFile> open(const std::string &path) {
+    FileHandle file{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    struct stat st;
+    if (!file || ::fstat(file.get(), &st) != 0)
+      return Error::kIoError;
+
+    MappedFile mapped;
+    if (st.st_size == 0)
+      return mapped;
+    auto *data = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE,
+                        file.get(), 0);
+    if (data == MAP_FAILED)
+      return Error::kIoError;
+    mapped.data_ = data;
+    mapped.size_ = size_t(st.st_size);
+    ::madvise(mapped.data_, mapped.size_, MADV_SEQUENTIAL);
+    return mapped;
+  }
+
+  Slice<const uint8_t> bytes() const {
+    return {static_cast<const uint8_t *>(data_), size_};
+  }
+
+  /// Starts reading bytes `[first, last)` in.
+  void prefetch(size_t first, size_t last) const {
+    last = std::min(last, size_);
+    first = first / pageSize() * pageSize();
+    if (first < last)
+      ::madvise(static_cast<uint8_t *>(data_) + first, last - first,
+                MADV_WILLNEED);
+  }
+
+  /// Drops the pages of bytes `[first, last)`. A page `last` ends inside is
+  /// kept, for the next range to finish.
+  void release(size_t first, size_t last) const {
+    last = last >= size_ ? size_ : last / pageSize() * pageSize();
+    first = first / pageSize() * pageSize();
+    if (first < last)
+      ::madvise(static_cast<uint8_t *>(data_) + first, last - first,
+                MADV_DONTNEED);
+  }
+
+private:
+  static size_t pageSize() {
+    static const auto size = size_t(::sysconf(_SC_PAGESIZE));
+    return size;
+  }
+
+  void *data_ = nullptr;
+  size_t size_ = 0ull;
+};
+
+} // namespace detail
+
+/// Encodes payloads held in files into shard files and back, for payloads
+/// too large to hold in memory along with their shards.
+///
+/// The payload and the shards are mapped, and the columns are worked on in
+/// groups sized so that the group's buffers, double buffered, and the pages
+/// it reads fit the window. The pages of the next group are read ahead
+/// while the current one is encoded, the output of a group is written by a
+/// second thread while the next one is computed, and the pages of a group
+/// are dropped once it is done.
+template <typename TPolyEncoder> class FileCodec final {
+public:
+  using Codec = ReedSolomon<TPolyEncoder>;
+
+  /// Default bound of the memory a pass works in.
+  static constexpr size_t kDefaultWindow = 64ull << 20;
+
+  explicit FileCodec(const Codec &codec, size_t window = kDefaultWindow)
+      : codec_{codec}, window_{window} {}
+
+  /// Encodes the payload in `payload_path` into the files
+  /// `shard_paths[0..wantedN())`, created or truncated. Each shard file is
+  /// written front to back.
+  Result<bool> encodeFile(const std::string &payload_path,
+                          const std::vector<std::string> &shard_paths) const {
+    constexpr auto kSymbolBytes = Codec::kSymbolBytes;
+    const auto n = codec_.wantedN();
+    if (shard_paths.size() < n)
+      return Error::kNeedMoreShards;
+
+    auto mapped = detail::MappedFile::open(payload_path);
+    if (resultHasError(mapped))
+      return resultGetError(std::move(mapped));
+    const auto payload = resultGetValue(std::move(mapped));
+    // The encode paths take the payload mutable but only read it.
+    const Slice<uint8_t> bytes{const_cast<uint8_t *>(payload.bytes().data()),
+                               payload.bytes().size()};
+    if (bytes.empty())
+      return Error::kPayloadSizeIsZero;
+
+    const auto shard_len = codec_.shardLen(bytes.size());
+    std::vector<detail::FileHandle> files;
+    files.reserve(n);
+    for (size_t i = 0ull; i < n; ++i) {
+      files.emplace_back(::open(shard_paths[i].c_str(),
+                                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                0644));
+      if (!files.back() ||
+          ::ftruncate(files.back().get(), off_t(shard_len)) != 0)
+        return Error::kIoError;
+    }
+
+    const auto col_bytes = codec_.k() * kSymbolBytes;
+    const auto columns = shard_len / kSymbolBytes;
+    const auto group = std::min(
+        columns, groupColumns(kSymbolBytes * (2ull * n + codec_.k())));
+    auto write = [&files, n](const uint8_t *data, size_t c0, size_t segment) {
+      for (size_t i = 0ull; i < n; ++i)
+        if (!files[i].writeAll(data + i * segment, segment, c0 * kSymbolBytes))
+          return false;
+      return true;
+    };
+    std::vector<uint8_t> buffers[2];
+    std::vector<uint8_t *> segments(n);
+    std::future<bool> written;
+
+    for (size_t c0 = 0ull, g = 0ull; c0 < columns; c0 += group, ++g) {
+      const auto c1 = std::min(columns, c0 + group);
+      const auto segment = (c1 - c0) * kSymbolBytes;
+      payload.prefetch(c1 * col_bytes, (c1 + group) * col_bytes);
+
+      auto &buffer = buffers[g % 2ull];
+      buffer.resize(n * segment);
+      for (size_t i = 0ull; i < n; ++i)
+        segments[i] = buffer.data() + i * segment;
+      codec_.encodeColumnRange(bytes, c0, c1, segments.data());
+      payload.release(c0 * col_bytes, c1 * col_bytes);
+
+      if (written.valid() && !written.get())
+        return Error::kIoError;
+      written =
+          std::async(std::launch::async, write, buffer.data(), c0, segment);
+    }
+    if (written.valid() && !written.get())
+      return Error::kIoError;
+    return true;
+  }
+
+  /// Recovers the first `payload_size` bytes of the payload into
+  /// `output_path`, created or truncated, from the files `shard_paths`,
+  /// indexed by shard. Empty paths and files that do not open are erased
+  /// shards; only the `k` the decode reads are paged in.
+  /// @return `kOutputTooLong` if the shards hold fewer than `payload_size`
+  /// bytes
+  Result<bool> reconstructFile(const std::vector<std::string> &shard_paths,
+                               const std::string &output_path,
+                               size_t payload_size) const {
+    constexpr auto kSymbolBytes = Codec::kSymbolBytes;
+    std::vector<detail::MappedFile> files(shard_paths.size());
+    std::vector<Slice<const uint8_t>> shards(shard_paths.size());
+    for (size_t i = 0ull; i < shard_paths.size(); ++i) {
+      if (shard_paths[i].empty())
+        continue;
+      auto mapped = detail::MappedFile::open(shard_paths[i]);
+      if (resultHasError(mapped))
+        continue;
+      files[i] = resultGetValue(std::move(mapped));
+      shards[i] = files[i].bytes();
+    }
+
+    auto planned = codec_.planDecode(shards);
+    if (resultHasError(planned))
+      return resultGetError(std::move(planned));
+    const auto plan = resultGetValue(std::move(planned));
+    const auto col_bytes = codec_.k() * kSymbolBytes;
+    if (payload_size > plan.shard_len * col_bytes)
+      return Error::kOutputTooLong;
+
+    detail::FileHandle output{::open(
+        output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+    if (!output || ::ftruncate(output.get(), off_t(payload_size)) != 0)
+      return Error::kIoError;
+
+    const auto columns = (payload_size + col_bytes - 1) / col_bytes;
+    const auto group = std::min(
+        columns, groupColumns(kSymbolBytes * (2ull * codec_.k() +
+                                              codec_.block())));
+    std::vector<uint8_t> buffers[2];
+    std::vector<Slice<const uint8_t>> shifted(plan.chosen.size());
+    std::future<bool> written;
+
+    for (size_t c0 = 0ull, g = 0ull; c0 < columns; c0 += group, ++g) {
+      const auto c1 = std::min(columns, c0 + group);
+      const auto size = std::min(payload_size, c1 * col_bytes) - c0 * col_bytes;
+      for (const auto i : plan.subset)
+        files[i].prefetch(c1 * kSymbolBytes, (c1 + group) * kSymbolBytes);
+
+      auto &buffer = buffers[g % 2ull];
+      if (plan.m == codec_.block()) {
+        for (size_t p = 0ull; p < plan.chosen.size(); ++p)
+          shifted[p] = plan.chosen[p].empty()
+                           ? plan.chosen[p]
+                           : plan.chosen[p].subspan(c0 * kSymbolBytes);
+        buffer.resize(size);
+        codec_.interleaveSystematic(shifted, buffer.data(), size);
+      } else {
+        buffer.clear();
+        codec_.decodeColumns(plan.chosen, plan.m, *plan.error_poly, c0, c1,
+                             buffer);
+        buffer.resize(size);
+      }
+      for (const auto i : plan.subset)
+        files[i].release(c0 * kSymbolBytes, c1 * kSymbolBytes);
+
+      if (written.valid() && !written.get())
+        return Error::kIoError;
+      written = std::async(std::launch::async, &detail::FileHandle::writeAll,
+                           &output, buffer.data(), size, c0 * col_bytes);
+    }
+    if (written.valid() && !written.get())
+      return Error::kIoError;
+    return true;
+  }
+
+  size_t window() const { return window_; }
+
+private:
+  /// Columns per group when each one takes `column_bytes` of the window.
+  size_t groupColumns(size_t column_bytes) const {
+    return std::max(size_t(1ull), window_ / column_bytes);
+  }
+
+  const Codec &codec_;
+  const size_t window_;
+};
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_FILE_CODEC_HPP
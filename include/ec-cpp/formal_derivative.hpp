@@ -0,0 +1,212 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_FORMAL_DERIVATIVE_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_FORMAL_DERIVATIVE_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdlib.h>
+#include <type_traits>
+#include <utility>
+
+#include <ec-cpp/cpu.hpp>
+
+namespace ec_cpp {
+
+namespace detail {
+
+typedef uint8_t U8x32 __attribute__((vector_size(32)));
+typedef uint8_t U8x64 __attribute__((vector_size(64)));
+
+template <typename V>
+EC_CPP_ALWAYS_INLINE void xorBytesKernel(uint8_t *dst, const uint8_t *src,
+                                         size_t bytes) {
+  size_t i = 0ull;
+  for (; i + sizeof(V) <= bytes; i += sizeof(V)) {
+    V a, b;
+    memcpy(&a, dst + i, sizeof(V));
+    memcpy(&b, src + i, sizeof(V));
+    a ^= b;
+    memcpy(dst + i, &a, sizeof(V));
+  }
+  for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)) {
+    uint64_t a, b;
+    memcpy(&a, dst + i, sizeof(a));
+    memcpy(&b, src + i, sizeof(b));
+    a ^= b;
+    memcpy(dst + i, &a, sizeof(a));
+  }
+  for (; i < bytes; ++i)
+    dst[i] ^= src[i];
+}
+
+EC_CPP_TARGET("avx2")
+inline void xorBytesAvx2(uint8_t *dst, const uint8_t *src, size_t bytes) {
+  xorBytesKernel<U8x32>(dst, src, bytes);
+}
+
+EC_CPP_TARGET("avx512bw")
+inline void xorBytesAvx512(uint8_t *dst, const uint8_t *src, size_t bytes) {
+  xorBytesKernel<U8x64>(dst, src, bytes);
+}
+
+/// `dst[0..bytes) ^= src[0..bytes)`, the ranges not overlapping.
+inline void xorBytes(void *dst, const void *src, size_t bytes) {
+  auto *d = static_cast<uint8_t *>(dst);
+  const auto *s = static_cast<const uint8_t *>(src);
+  if (cpu::hasAvx512bw())
+    return xorBytesAvx512(d, s, bytes);
+  if (cpu::hasAvx2())
+    return xorBytesAvx2(d, s, bytes);
+  xorBytesKernel<uint64_t>(d, s, bytes);
+}
+
+/// `xorBytes` of a size known at compile time, left to the compiler to
+/// unroll.
+template <size_t Bytes>
+EC_CPP_ALWAYS_INLINE void xorFixed(void *dst, const void *src) {
+  uint8_t a[Bytes], b[Bytes];
+  memcpy(a, dst, Bytes);
+  memcpy(b, src, Bytes);
+  for (size_t i = 0ull; i < Bytes; ++i)
+    a[i] ^= b[i];
+  memcpy(dst, a, Bytes);
+}
+
+/// Elements per block of the formal derivative: the steps shorter than a
+/// block stay inside it, and are unrolled.
+template <typename T>
+constexpr size_t kDerivativeBlock = [] {
+  size_t block = 1ull;
+  while (block * 2ull * sizeof(T) <= 64ull)
+    block = (block << 1ull);
+  return block;
+}();
+
+/// Steps `[I, Block)` of the formal derivative of one block, in order.
+template <typename T, size_t Block, size_t I = 1ull>
+EC_CPP_ALWAYS_INLINE void derivativeSteps(T *data) {
+  if constexpr (I < Block) {
+    constexpr auto length = I & (0ull - I);
+    xorFixed<length * sizeof(T)>(data + I - length, data + I);
+    derivativeSteps<T, Block, I + 1ull>(data);
+  }
+}
+
+/// Level `L` of a 64-byte block held in eight words: every element `t`
+/// with bit `L` clear takes `orig[t + L]`. Below a word this is a shift and
+/// a mask, above it a word move.
+template <typename T, size_t L, size_t... Ws>
+EC_CPP_ALWAYS_INLINE void derivativeLevel(uint64_t *acc, const uint64_t *orig,
+                                          std::index_sequence<Ws...>) {
+  constexpr auto kShift = L * sizeof(T);
+  if constexpr (kShift < 8ull) {
+    constexpr auto kMask = [] {
+      uint64_t mask = 0ull;
+      for (size_t t = 0ull; t < 8ull / sizeof(T); ++t)
+        if ((t & L) == 0ull)
+          mask |= ((1ull << (sizeof(T) * 8ull)) - 1ull)
+                  << (t * sizeof(T) * 8ull);
+      return mask;
+    }();
+    ((acc[Ws] ^= (orig[Ws] >> (kShift * 8ull)) & kMask), ...);
+  } else {
+    ((((Ws * 8ull / sizeof(T)) & L) == 0ull
+          ? void(acc[Ws] ^= orig[Ws + kShift / 8ull])
+          : void()),
+     ...);
+  }
+}
+
+template <typename T, size_t L>
+EC_CPP_ALWAYS_INLINE void derivativeLevels(uint64_t *acc,
+                                           const uint64_t *orig) {
+  if constexpr (L != 0ull) {
+    derivativeLevel<T, L>(acc, orig, std::make_index_sequence<8ull>{});
+    derivativeLevels<T, (L >> 1ull)>(acc, orig);
+  }
+}
+
+/// Steps `[1, Block)` of the formal derivative of one block. No step reads
+/// a position an earlier step wrote, writes staying below the step, so for
+/// power of two elements of up to 32 bytes, a block being 64 bytes, all the
+/// levels are taken from the block as it was on entry, held in registers.
+template <typename T, size_t Block>
+EC_CPP_ALWAYS_INLINE void derivativeBlock(T *data) {
+  if constexpr (Block * sizeof(T) == 64ull &&
+                std::endian::native == std::endian::little) {
+    uint64_t orig[8], acc[8];
+    memcpy(orig, data, sizeof(orig));
+    memcpy(acc, data, sizeof(acc));
+    derivativeLevels<T, (Block >> 1ull)>(acc, orig);
+    memcpy(data, acc, sizeof(acc));
+  } else {
+    derivativeSteps<T, Block>(data);
+  }
+}
+
+} // namespace detail
+
+/// Formal derivative in the novel polynomial basis, in place: step `i` of
+/// `[1, size)` adds `data[i..i + l)` into `data[i - l..i)`, `l` being the
+/// lowest set bit of `i`, then the positions from `size` to `capacity` are
+/// folded into the first `size`. Positions from `capacity` on, at least
+/// `size`, read as zero. `T` is any trivially copyable element, a
+/// symbol or a buffer of symbols, added bytewise.
+///
+/// Steps shorter than a 64-byte block stay inside their block and are
+/// unrolled; the step at the start of each block is one wide XOR of whole
+/// blocks.
+template <typename T>
+void formalDerivative(T *data, size_t size, size_t capacity) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  constexpr auto kBlock = detail::kDerivativeBlock<T>;
+
+  if (size != 0ull && size % kBlock == 0ull) {
+    detail::derivativeBlock<T, kBlock>(data);
+    for (size_t b = kBlock; b < size; b += kBlock) {
+      const size_t length = b & (0ull - b);
+      detail::xorBytes(data + b - length, data + b,
+                       std::min(length, capacity - b) * sizeof(T));
+      detail::derivativeBlock<T, kBlock>(data + b);
+    }
+  } else {
+    for (size_t i = 1ull; i < size; ++i) {
+      const size_t length = i & (0ull - i);
+      detail::xorBytes(data + i - length, data + i,
+                       std::min(length, capacity - i) * sizeof(T));
+    }
+  }
+
+  for (size_t i = size; size != 0ull && i < capacity; i = (i << 1ull))
+    detail::xorBytes(data, data + i, std::min(size, capacity - i) * sizeof(T));
+}
+
+/// One element at a time, in the order of the definition. Reference for
+/// `formalDerivative`.
+template <typename T>
+void formalDerivativeScalar(T *data, size_t size, size_t capacity) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  auto swallow = [&](size_t j, size_t offset) {
+    if (j + offset < capacity)
+      detail::xorFixed<sizeof(T)>(data + j, data + j + offset);
+  };
+
+  for (size_t i = 1ull; i < size; ++i) {
+    const auto length = ((i ^ (i - 1ull)) + 1ull) >> 1ull;
+    for (size_t j = (i - length); j < i; ++j)
+      swallow(j, length);
+  }
+  for (size_t i = size; size != 0ull && i < capacity; i = (i << 1ull))
+    for (size_t j = 0ull; j < size; ++j)
+      swallow(j, i);
+}
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_FORMAL_DERIVATIVE_HPP
@@ -6,10 +6,13 @@
 #ifndef NOVELPOLY_REED_SOLOMON_CRUST_POLY_ENCODER_HPP
 #define NOVELPOLY_REED_SOLOMON_CRUST_POLY_ENCODER_HPP
 
+#include <algorithm>
 #include <array>
 #include <assert.h>
 #include <cstdint>
 #include <cstring>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <stdlib.h>
 #include <tuple>
@@ -17,22 +20,42 @@
 
 #include <ec-cpp/additive_fft.hpp>
 #include <ec-cpp/errors.hpp>
+#include <ec-cpp/formal_derivative.hpp>
 #include <ec-cpp/math.hpp>
 #include <ec-cpp/types.hpp>
 #include <ec-cpp/walsh.hpp>
 
 namespace ec_cpp {
 
+/// A codeword of `N` positions transformed in blocks of `K`.
+template <size_t N, size_t K> struct FixedShape {
+  static constexpr size_t kN = N;
+  static constexpr size_t kK = K;
+};
+
+/// The shapes `PolyEncoder` has compile-time specialized encode kernels
+/// for: those of the validator set sizes that stay in use for long periods,
+/// 300, 500 and 1000, in both code versions. Other shapes take the generic
+/// path.
+using FixedShapes = std::tuple<FixedShape<512ull, 64ull>,
+                               FixedShape<512ull, 128ull>,
+                               FixedShape<1024ull, 256ull>,
+                               FixedShape<2048ull, 512ull>>;
+
 template <typename TDescriptor> struct PolyEncoder final {
   using Descriptor = TDescriptor;
   using Field = std::vector<Additive<Descriptor>>;
   PolyEncoder(const Descriptor &descriptor) : descriptor_{descriptor} {}
 
+  const Descriptor &descriptor() const { return descriptor_; }
+
+  const AdditiveFFT<Descriptor> &afft() const { return AFFT; }
+
   Result<bool> encodeSub(Field &codeword, Slice<uint8_t> bytes, size_t n,
                          size_t k) const {
     assert(math::isPowerOf2(n));
     assert(math::isPowerOf2(k));
-    assert(bytes.size() <= (k << 1));
+    assert(bytes.size() <= k * sizeof(typename Descriptor::Elt));
     assert(k <= n / 2);
 
     const auto dl = bytes.size();
@@ -50,7 +73,7 @@ template <typename TDescriptor> struct PolyEncoder final {
     assert(math::isPowerOf2(l));
     assert(l >= dl);
 
-    auto zero_bytes_to_add = n * 2 - dl;
+    auto zero_bytes_to_add = n * sizeof(typename Descriptor::Elt) - dl;
     local().clear();
     local().reserve((bytes.size() + 1) / sizeof(typename Descriptor::Elt) +
                     zero_bytes_to_add / sizeof(typename Descriptor::Elt));
@@ -85,6 +108,81 @@ template <typename TDescriptor> struct PolyEncoder final {
     return true;
   }
 
+  /// Computes parity symbols `first..last` of a single column codeword.
+  /// Only the `k` payload symbols are loaded and only the transform blocks
+  /// overlapping `[first, last)` are evaluated. Positions below `k` are left
+  /// holding the inverse transform, not the payload.
+  Result<bool> encodeParitySub(Field &codeword, Slice<uint8_t> bytes, size_t n,
+                               size_t k, size_t first, size_t last) const {
+    assert(math::isPowerOf2(n));
+    assert(math::isPowerOf2(k));
+    assert(bytes.size() <= k * sizeof(typename Descriptor::Elt));
+    assert(k <= n / 2);
+    assert(k <= first && first <= last && last <= n);
+
+    codeword.resize(n);
+    loadSymbols(codeword.data(), k, bytes);
+    encodeParityLow(codeword.data(), n, k, first, last);
+    return true;
+  }
+
+  /// Same as `encodeParitySub`, with the `k` systematic symbols already
+  /// placed in `codeword[0..k)`.
+  void encodeParitySymbols(Field &codeword, size_t n, size_t k, size_t first,
+                           size_t last) const {
+    assert(math::isPowerOf2(n));
+    assert(math::isPowerOf2(k));
+    assert(k <= n / 2);
+    assert(k <= first && first <= last && last <= n);
+
+    codeword.resize(n);
+    encodeParityLow(codeword.data(), n, k, first, last);
+  }
+
+  /// Whether the encode of a codeword of `n` in blocks of `k` runs a
+  /// compile-time specialized kernel, see `FixedShapes`.
+  static constexpr bool hasFixedKernel(size_t n, size_t k) {
+    return std::apply(
+        [&](auto... shapes) {
+          return ((n == decltype(shapes)::kN && k == decltype(shapes)::kK &&
+                   decltype(shapes)::kN <= Descriptor::kFieldSize) ||
+                  ...);
+        },
+        FixedShapes{});
+  }
+
+  /// Evaluates the `k`-block transforms covering positions `[first, last)`,
+  /// whatever the shape, on the generic path. `codeword[0..k)` must hold
+  /// the payload symbols on entry.
+  void encodeParityGeneric(Additive<Descriptor> *codeword, size_t k,
+                           size_t first, size_t last) const {
+    auto *codeword_first_k = codeword;
+
+    AFFT.inverse_afft(codeword_first_k, k, 0, descriptor_.kTables,
+                      products());
+    for (size_t shift = k; shift < last; shift += k) {
+      if (shift + k <= first)
+        continue;
+
+      auto *codeword_at_shift = &codeword[shift];
+      memcpy(codeword_at_shift, codeword_first_k,
+             k * sizeof(codeword_first_k[0]));
+      AFFT.afft(codeword_at_shift, k, shift, descriptor_.kTables, products());
+    }
+  }
+
+  /// `encodeParityGeneric` for a codeword of `N` in blocks of `K`, with the
+  /// transform sizes, the block offsets and so the skew offsets all
+  /// constants.
+  template <size_t N, size_t K>
+  void encodeParityFixed(Additive<Descriptor> *codeword, size_t first,
+                         size_t last) const {
+    static_assert(K + K <= N && N <= Descriptor::kFieldSize);
+    AFFT.template inverseAfftFixed<K, 0ull>(codeword, descriptor_.kTables,
+                                            products());
+    encodeBlocksFixed<N, K, K>(codeword, first, last);
+  }
+
   /// [101...001] erasures are bit-array representation, where 1 - is empty and
   /// 0 - is full.
   template <typename Shard>
@@ -92,11 +190,22 @@ template <typename TDescriptor> struct PolyEncoder final {
                            std::array<typename TDescriptor::Multiplier,
                                       TDescriptor::kFieldSize> &log_walsh2,
                            size_t n) const {
-    auto is_erasured = [&](size_t i) -> bool {
-      return i >= erasure.size() || erasure[i].empty();
-    };
+    evalErrorPolynomialIf(
+        [&](size_t i) -> bool {
+          return i >= erasure.size() || erasure[i].empty();
+        },
+        std::min(n, erasure.size() + gap), log_walsh2, n);
+  }
 
-    const auto z = std::min(n, erasure.size() + gap);
+  /// Same as `evalErrorPolynomial`, position `i < z` being erased when
+  /// `is_erasured(i)`. For an erased `i` the result is the log of
+  /// `1 / prod(i + j)` over the other erased `j`, for a present one the log
+  /// of `prod(i + j)` over all erased `j`.
+  template <typename IsErasured>
+  void evalErrorPolynomialIf(const IsErasured &is_erasured, size_t z,
+                             std::array<typename TDescriptor::Multiplier,
+                                        TDescriptor::kFieldSize> &log_walsh2,
+                             size_t n) const {
     for (size_t i = 0; i < z; ++i)
       log_walsh2[i] = typename Descriptor::Multiplier(is_erasured(i));
 
@@ -115,6 +224,103 @@ template <typename TDescriptor> struct PolyEncoder final {
                         log_walsh2[i];
   }
 
+  /// Finds the corrupted positions of a received word. `word[i]` holds
+  /// codeword position `i` for every `i < n` with `received(i)`, the others
+  /// are erasures. With `r` received positions, up to `(r - k) / 2`
+  /// corrupted ones are located: syndromes of the punctured code are taken
+  /// against the dual (generalized RS) code, and the error locator found by
+  /// Berlekamp-Massey is evaluated at every received position.
+  /// @return the corrupted positions, or nothing when the word is too far
+  /// from any codeword to tell
+  template <typename IsReceived>
+  std::optional<std::vector<size_t>>
+  locateErrors(const std::vector<typename Descriptor::Elt> &word, size_t n,
+               size_t k, const IsReceived &received) const {
+    using Elt = typename Descriptor::Elt;
+    assert(word.size() >= n);
+
+    std::vector<size_t> positions;
+    for (size_t i = 0ull; i < n; ++i)
+      if (received(i))
+        positions.push_back(i);
+    if (positions.size() < k)
+      return std::nullopt;
+
+    const auto t = (positions.size() - k) / 2;
+    if (t == 0ull)
+      return std::vector<size_t>{};
+
+    /// Column multipliers of the dual code, `1 / prod(i + j)` over the other
+    /// received `j`, in the log domain.
+    std::array<typename Descriptor::Multiplier, Descriptor::kFieldSize>
+        log_v = {0};
+    evalErrorPolynomialIf([&](size_t i) { return received(i); }, n, log_v,
+                          Descriptor::kFieldSize);
+
+    std::vector<Elt> syndromes(t * 2ull, Elt(0));
+    for (const auto i : positions) {
+      auto term = Additive<Descriptor>{word[i]}.mul(log_v[i],
+                                                    descriptor_.kTables);
+      if (i == 0ull) {
+        syndromes[0] ^= term.point_0;
+        continue;
+      }
+      const auto log_point = Additive<Descriptor>{Elt(i)}.toMultiplier(
+          descriptor_.kTables);
+      for (auto &s : syndromes) {
+        s ^= term.point_0;
+        term = term.mul(log_point, descriptor_.kTables);
+      }
+    }
+
+    /// Berlekamp-Massey: shortest `c` with
+    /// `s[j] = sum(c[m] * s[j - m], m = 1..len)`.
+    std::vector<Elt> c(t * 2ull + 1ull, Elt(0));
+    std::vector<Elt> b(t * 2ull + 1ull, Elt(0));
+    c[0] = b[0] = Elt(1);
+    size_t len = 0ull;
+    size_t shift = 1ull;
+    Elt b_discrepancy(1);
+    for (size_t j = 0ull; j < syndromes.size(); ++j) {
+      auto d = syndromes[j];
+      for (size_t m = 1ull; m <= len; ++m)
+        d ^= mul(c[m], syndromes[j - m]);
+
+      if (d == Elt(0)) {
+        ++shift;
+        continue;
+      }
+      const auto scale = div(d, b_discrepancy);
+      auto prev = c;
+      for (size_t m = 0ull; m + shift < c.size(); ++m)
+        c[m + shift] ^= mul(scale, b[m]);
+      if (len * 2ull <= j) {
+        len = j + 1ull - len;
+        b = std::move(prev);
+        b_discrepancy = d;
+        shift = 1ull;
+      } else {
+        ++shift;
+      }
+    }
+    if (len > t)
+      return std::nullopt;
+
+    /// The locator `x^len * c(1 / x)` vanishes exactly at the corrupted
+    /// points, the point 0 included.
+    std::vector<size_t> corrupted;
+    for (const auto i : positions) {
+      Elt acc(0);
+      for (size_t m = 0ull; m <= len; ++m)
+        acc = mul(acc, Elt(i)) ^ c[m];
+      if (acc == Elt(0))
+        corrupted.push_back(i);
+    }
+    if (corrupted.size() != len)
+      return std::nullopt;
+    return corrupted;
+  }
+
   template <typename Shard>
   Result<bool> reconstructSub(
       std::vector<uint8_t> &recovered_bytes, Field &codeword,
@@ -156,11 +362,61 @@ private:
   const AdditiveFFT<Descriptor> AFFT{
       AdditiveFFT<Descriptor>::initalize(descriptor_.kTables)};
 
+  struct LazyProducts {
+    std::once_flag once;
+    std::unique_ptr<const SkewProducts<Descriptor>> value;
+  };
+  std::shared_ptr<LazyProducts> products_ = std::make_shared<LazyProducts>();
+
+  /// Split product tables of the wide transform layers, built on first use.
+  /// Table-free descriptors go without, the tables being what they avoid.
+  const SkewProducts<Descriptor> *products() const {
+    if constexpr (TableFreeProduct<Descriptor>) {
+      return nullptr;
+    } else {
+      std::call_once(products_->once, [&] {
+        products_->value = std::make_unique<const SkewProducts<Descriptor>>(
+            AFFT, descriptor_.kTables);
+      });
+      return products_->value.get();
+    }
+  }
+
   Field &local() const {
     thread_local Field data;
     return data;
   }
 
+  typename Descriptor::Elt mul(typename Descriptor::Elt a,
+                               typename Descriptor::Elt b) const {
+    if (b == typename Descriptor::Elt(0))
+      return b;
+    return Additive<Descriptor>{a}
+        .mul(Additive<Descriptor>{b}.toMultiplier(descriptor_.kTables),
+             descriptor_.kTables)
+        .point_0;
+  }
+
+  typename Descriptor::Elt div(typename Descriptor::Elt a,
+                               typename Descriptor::Elt b) const {
+    assert(b != typename Descriptor::Elt(0));
+    const auto log_b =
+        Additive<Descriptor>{b}.toMultiplier(descriptor_.kTables);
+    return Additive<Descriptor>{a}
+        .mul(typename Descriptor::Multiplier(Descriptor::kOneMask - log_b),
+             descriptor_.kTables)
+        .point_0;
+  }
+
+  /// Symbols per block for the decode layers that stay inside a block.
+  static constexpr size_t kDecodeBlock = 4096ull;
+
+  /// Runs as few sweeps over the codeword as the data dependencies allow:
+  /// the multiply by the error polynomial is folded into the first inverse
+  /// layer, the inverse layers below `kDecodeBlock` run block by block, the
+  /// forward layers above `recover_up_to` only fold into the prefix that is
+  /// read back and the last forward layers run block by block together with
+  /// the final multiply.
   template <typename Shard>
   void decode_main(Field &codeword, size_t recover_up_to,
                    const std::vector<Shard> &erasure, size_t gap,
@@ -169,23 +425,78 @@ private:
                    size_t n) const {
     assert(codeword.size() + gap == n);
     assert(n >= recover_up_to);
-    assert(erasure.size() + gap == n);
+    assert(erasure.size() + gap >= n);
 
-    for (size_t i = 0ull; i < codeword.size(); ++i)
-      codeword[i] = erasure[i].empty()
-                        ? Additive<Descriptor>{0}
-                        : codeword[i].mul(log_walsh2[i], descriptor_.kTables);
+    withKernel<Descriptor>([&](auto kernel) {
+      decodeWith<typename decltype(kernel)::type>(codeword, recover_up_to,
+                                                  erasure, log_walsh2, n);
+    });
+  }
 
-    codeword.resize(codeword.size() + gap);
-    AFFT.inverse_afft(codeword.data(), n, 0, descriptor_.kTables);
-    tweaked_formal_derivative(codeword, n);
+  /// `decode_main` with the products of `Kernel`.
+  template <typename Kernel, typename Shard>
+  void decodeWith(Field &codeword, size_t recover_up_to,
+                  const std::vector<Shard> &erasure,
+                  const std::array<typename Descriptor::Multiplier,
+                                   Descriptor::kFieldSize> &log_walsh2,
+                  size_t n) const {
+    const auto &tables = descriptor_.kTables;
+    const auto *products = this->products();
+    const auto received = codeword.size();
+    codeword.resize(n);
+    auto *data = codeword.data();
+
+    // table-free descriptors take the error polynomial as constants, turned
+    // once here rather than on every product
+    thread_local std::vector<typename ProductFactor<Descriptor>::type> factors;
+    if constexpr (TableFreeProduct<Descriptor>) {
+      factors.resize(n);
+      for (size_t i = 0ull; i < n; ++i)
+        factors[i] = Descriptor::constant(log_walsh2[i], tables);
+    }
+    const auto scale = [&](Additive<Descriptor> x, size_t i) {
+      if constexpr (TableFreeProduct<Descriptor>)
+        return Additive<Descriptor>{Kernel::mulConstant(x.point_0, factors[i])};
+      else
+        return x.mul(log_walsh2[i], tables);
+    };
+
+    const auto load = [&](size_t i) {
+      return (i >= received || erasure[i].empty()) ? Additive<Descriptor>{0}
+                                                   : scale(data[i], i);
+    };
+
+    const auto block = std::min(n, kDecodeBlock);
+    for (size_t b = 0ull; b < n; b += block) {
+      for (size_t i = b; i < b + block; i += 2ull) {
+        auto lo = load(i);
+        auto hi = load(i + 1ull);
+        AFFT.template inverseButterflyAt<Kernel>(lo, hi, i, tables, products);
+        data[i] = lo;
+        data[i + 1ull] = hi;
+      }
+      AFFT.template inverseLayersWith<Kernel>(data + b, block, b, 2ull, block,
+                                              tables, products);
+    }
+    AFFT.template inverseLayersWith<Kernel>(data, n, 0ull, block, n, tables,
+                                            products);
 
-    AFFT.afft(codeword.data(), n, 0, descriptor_.kTables);
+    tweaked_formal_derivative(codeword, n);
 
-    for (size_t i = 0ull; i < recover_up_to; ++i)
-      codeword[i] = (i >= erasure.size() || erasure[i].empty())
-                        ? codeword[i].mul(log_walsh2[i], descriptor_.kTables)
-                        : Additive<Descriptor>{0};
+    const auto keep = math::nextHighPowerOf2(recover_up_to);
+    AFFT.template foldToPrefixWith<Kernel>(data, n, keep, tables, products);
+    const auto keep_block = std::min(keep, kDecodeBlock);
+    AFFT.template forwardLayersWith<Kernel>(data, keep, 0ull, keep_block,
+                                            keep, tables, products);
+    for (size_t b = 0ull; b < recover_up_to; b += keep_block) {
+      AFFT.template forwardLayersWith<Kernel>(data + b, keep_block, b, 1ull,
+                                              keep_block, tables, products);
+      const auto end = std::min(b + keep_block, recover_up_to);
+      for (size_t i = b; i < end; ++i)
+        data[i] = (i >= erasure.size() || erasure[i].empty())
+                      ? scale(data[i], i)
+                      : Additive<Descriptor>{0};
+    }
   }
 
   void tweaked_formal_derivative(Field &codeword, size_t n) const {
@@ -193,25 +504,8 @@ private:
   }
 
   void formal_derivative(Field &cos, size_t size) const {
-    auto swallow = [&](size_t j, size_t offset) {
-      const auto index = j + offset;
-      const auto in_range = index < cos.size();
-      cos[j].point_0 =
-          cos[j].point_0 ^
-          (in_range ? cos[index].point_0 : typename Descriptor::Elt(0));
-    };
-
-    for (size_t i = 1ull; i < size; ++i) {
-      const auto length = ((i ^ (i - 1ull)) + 1ull) >> 1ull;
-      for (size_t j = (i - length); j < i; ++j)
-        swallow(j, length);
-    }
-    auto i = size;
-    while (i < Descriptor::kFieldSize && i < cos.size()) {
-      for (size_t j = 0ull; j < size; ++j)
-        swallow(j, i);
-      i = (i << 1ull);
-    }
+    ec_cpp::formalDerivative(cos.data(), size,
+                             std::min(cos.size(), Descriptor::kFieldSize));
   }
 
   void encodeLow(const Field &data, size_t k, Field &codeword, size_t n) const {
@@ -222,21 +516,70 @@ private:
     assert(math::isPowerOf2(k));
     assert((n / k) * k == n);
 
-    auto *codeword_first_k = codeword.data();
-    auto *codeword_skip_first_k = &codeword[k];
+    encodeParityLow(codeword.data(), n, k, k, n);
+    memcpy(&codeword[0], &data[0], k * sizeof(data[0]));
+  }
 
-    AFFT.inverse_afft(codeword_first_k, k, 0, descriptor_.kTables);
-    for (size_t shift = k; shift < n; shift += k) {
-      auto *codeword_at_shift = &codeword_skip_first_k[(shift - k)];
-      [[maybe_unused]] auto *codeword_at_shift_end =
-          &codeword_skip_first_k[shift];
+  /// `encodeParityFixed` when `(n, k)` is one of `FixedShapes`,
+  /// `encodeParityGeneric` otherwise.
+  void encodeParityLow(Additive<Descriptor> *codeword, size_t n, size_t k,
+                       size_t first, size_t last) const {
+    const auto fixed = std::apply(
+        [&](auto... shapes) {
+          return (encodeParityIf(shapes, codeword, n, k, first, last) || ...);
+        },
+        FixedShapes{});
+    if (!fixed)
+      encodeParityGeneric(codeword, k, first, last);
+  }
 
-      memcpy(codeword_at_shift, codeword_first_k,
-             k * sizeof(codeword_first_k[0]));
-      AFFT.afft(codeword_at_shift, k, shift, descriptor_.kTables);
+  /// `encodeParityFixed<N, K>` if the shape is `(n, k)` and fits the field.
+  template <size_t N, size_t K>
+  bool encodeParityIf(FixedShape<N, K>, Additive<Descriptor> *codeword,
+                      size_t n, size_t k, size_t first, size_t last) const {
+    if constexpr (N <= Descriptor::kFieldSize)
+      if (n == N && k == K) {
+        encodeParityFixed<N, K>(codeword, first, last);
+        return true;
+      }
+    return false;
+  }
+
+  /// The blocks of `encodeParityFixed` from `Shift` on.
+  template <size_t N, size_t K, size_t Shift>
+  void encodeBlocksFixed(Additive<Descriptor> *codeword, size_t first,
+                         size_t last) const {
+    if constexpr (Shift < N) {
+      if (Shift >= last)
+        return;
+      if (Shift + K > first) {
+        memcpy(&codeword[Shift], codeword, K * sizeof(codeword[0]));
+        AFFT.template afftFixed<K, Shift>(&codeword[Shift],
+                                          descriptor_.kTables, products());
+      }
+      encodeBlocksFixed<N, K, Shift + K>(codeword, first, last);
     }
+  }
 
-    memcpy(&codeword[0], &data[0], k * sizeof(data[0]));
+  /// Loads big-endian payload symbols into `dst[0..count)`, padding with
+  /// zeros past the end of `bytes`.
+  static void loadSymbols(Additive<Descriptor> *dst, size_t count,
+                          Slice<uint8_t> bytes) {
+    constexpr auto kEltSize = sizeof(typename Descriptor::Elt);
+    const auto full = std::min(count, bytes.size() / kEltSize);
+
+    size_t i = 0ull;
+    for (; i < full; ++i)
+      dst[i] =
+          Additive<Descriptor>{Descriptor::fromBEBytes(&bytes[i * kEltSize])};
+
+    if (i < count && i * kEltSize < bytes.size()) {
+      uint8_t b[kEltSize] = {0};
+      memcpy(b, &bytes[i * kEltSize], bytes.size() - i * kEltSize);
+      dst[i++] = Additive<Descriptor>{Descriptor::fromBEBytes(b)};
+    }
+    for (; i < count; ++i)
+      dst[i] = Additive<Descriptor>{0};
   }
 };
 
@@ -6,14 +6,25 @@
 #ifndef NOVELPOLY_REED_SOLOMON_CRUST_REED_SOLOMON_HPP
 #define NOVELPOLY_REED_SOLOMON_CRUST_REED_SOLOMON_HPP
 
+#include <algorithm>
 #include <assert.h>
 #include <cstdint>
+#include <cstring>
+#include <memory>
 #include <optional>
+#include <random>
 #include <stdlib.h>
 #include <vector>
 
+#include <ec-cpp/additive_fft.hpp>
+#include <ec-cpp/bitsliced.hpp>
+#include <ec-cpp/blake2b.hpp>
+#include <ec-cpp/erasure_root.hpp>
 #include <ec-cpp/errors.hpp>
 #include <ec-cpp/math.hpp>
+#include <ec-cpp/shard_set.hpp>
+#include <ec-cpp/thread_pool.hpp>
+#include <ec-cpp/transpose.hpp>
 #include <ec-cpp/types.hpp>
 
 namespace ec_cpp {
@@ -21,8 +32,21 @@ namespace ec_cpp {
 template <typename TPolyEncoder> struct ReedSolomon final {
   using Shard = std::vector<uint8_t>;
 
+  /// Bytes per symbol. Every shard holds one symbol per payload column.
+  static constexpr size_t kSymbolBytes =
+      sizeof(typename TPolyEncoder::Descriptor::Elt);
+
+  /// Whether the bit-sliced engine is available, its bit planes being laid
+  /// out for GF(2^16).
+  static constexpr bool kHasBitsliced =
+      TPolyEncoder::Descriptor::kFieldBits == 16ull;
+
+  /// @param version codeword layout, see `CodeVersion`. In `kV2`, `k` must
+  /// be below `n`, and the `k` rounded up plus the `n - k` parity positions
+  /// must fit the field.
   static Result<ReedSolomon> create(size_t n, size_t k,
-                                    const TPolyEncoder &poly_enc) {
+                                    const TPolyEncoder &poly_enc,
+                                    CodeVersion version = CodeVersion::kV1) {
     if (n < 2) {
       return Error::kWantedShardCountTooLow;
     }
@@ -30,6 +54,17 @@ template <typename TPolyEncoder> struct ReedSolomon final {
       return Error::kWantedPayloadShardCountTooLow;
     }
 
+    if (version == CodeVersion::kV2) {
+      if (k >= n)
+        return Error::kWantedShardCountTooLow;
+      const auto block = math::nextHighPowerOf2(k);
+      const auto n_po2 =
+          std::max(math::nextHighPowerOf2(n + block - k), 2 * block);
+      if (n_po2 > TPolyEncoder::Descriptor::kFieldSize)
+        return Error::kWantedShardCountTooHigh;
+      return ReedSolomon{n_po2, k, block, n, poly_enc, version};
+    }
+
     const auto k_po2 = math::nextLowPowerOf2(k);
     const auto n_po2 = math::nextHighPowerOf2(n);
     assert(n * k_po2 <= n_po2 * k);
@@ -41,96 +76,468 @@ template <typename TPolyEncoder> struct ReedSolomon final {
     if (!math::isPowerOf2(n_po2) && !math::isPowerOf2(k_po2)) {
       return Error::kArgsMustBePowOf2;
     }
-    return ReedSolomon{n_po2, k_po2, n, poly_enc};
+    return ReedSolomon{n_po2, k_po2, k_po2, n, poly_enc, version};
+  }
+
+  /// Selects the transform engine of the encode and decode paths. The
+  /// bit-sliced one builds its skew matrices on first selection and pays
+  /// off on payloads of many columns, i.e. several times
+  /// `bitsliced::kLanes * k * 2` bytes. Without `kHasBitsliced` the log/exp
+  /// engine stays selected.
+  void selectEngine(TransformEngine engine) {
+    if (engine == TransformEngine::kLogExp)
+      bitsliced_.reset();
+    else if constexpr (kHasBitsliced)
+      if (!bitsliced_)
+        bitsliced_ = std::make_shared<const BitslicedEngine<TPolyEncoder>>(
+            poly_enc_, n_);
+  }
+
+  TransformEngine engine() const {
+    return bitsliced_ ? TransformEngine::kBitsliced : TransformEngine::kLogExp;
+  }
+
+  /// Selects the byte order of the symbols in the shards `encode` produces
+  /// and every other call takes. The erasure trie and root always commit to
+  /// the big-endian wire format; `convertShards` goes between the two.
+  void selectShardFormat(ShardFormat format) { format_ = format; }
+
+  ShardFormat shardFormat() const { return format_; }
+
+  /// Rewrites `shards` in place from format `from` to format `to`.
+  static void convertShards(std::vector<Shard> &shards, ShardFormat from,
+                            ShardFormat to) {
+    if (from == to || !shardSwap(ShardFormat::kBigEndian))
+      return;
+    for (auto &shard : shards)
+      copyShardSymbols(ShardFormat::kBigEndian, shard.data(), shard.data(),
+                       shard.size() / kSymbolBytes);
   }
 
   Result<std::vector<Shard>> encode(const Slice<uint8_t> bytes) {
     if (bytes.empty())
       return Error::kPayloadSizeIsZero;
 
-    const auto shard_len = shardLen(bytes.size());
-    assert(shard_len > 0);
+    return encodeShards(bytes, 0ull, wanted_n_);
+  }
 
-    const auto validator_count = wanted_n_;
-    const auto k2 = k_ * 2;
+  /// Encode only the parity shards `k..n-1`. The systematic shards `0..k-1`
+  /// are a plain de-interleave of the payload, so callers that already hold
+  /// the data do not pay for them.
+  /// @return `n - k` shards, the first one being shard `k`
+  Result<std::vector<Shard>> encodeParity(const Slice<uint8_t> bytes) {
+    if (bytes.empty())
+      return Error::kPayloadSizeIsZero;
+
+    return encodeShards(bytes, k_, wanted_n_);
+  }
 
+  struct EncodedChunks {
     std::vector<Shard> shards;
-    shards.assign(validator_count, Shard(shard_len));
+    ErasureTrie trie;
+  };
+
+  /// Encode and commit to the shards with an erasure trie in the same pass.
+  /// Columns are produced block by block and every shard segment is hashed
+  /// right after it is written, while it is still in cache. Both steps are
+  /// spread across `pool`.
+  Result<EncodedChunks> encodeWithTrie(const Slice<uint8_t> bytes,
+                                       ThreadPool &pool = ThreadPool::shared()) {
+    if (bytes.empty())
+      return Error::kPayloadSizeIsZero;
+
+    const auto shard_len = shardLen(bytes.size());
+    std::vector<Shard> shards;
+    shards.assign(wanted_n_, Shard(shard_len));
+
+    auto hashes =
+        encodeHashed(bytes, pool, [&](size_t shard, size_t first_col) {
+          return shards[shard].data() + first_col * kSymbolBytes;
+        });
+    convertShards(shards, ShardFormat::kBigEndian, format_);
+    return EncodedChunks{std::move(shards), ErasureTrie{std::move(hashes)}};
+  }
+
+  /// Encodes into `set`, `wantedN()` shards of `shardLen(bytes.size())`
+  /// bytes, one column block at a time, calling `on_block(first, last)` as
+  /// soon as bytes `[first, last)` of every shard are final. A stage
+  /// attached there, such as a `ShardWriter`, runs while the rest of the
+  /// payload is encoded.
+  template <typename OnBlock>
+  Result<bool> encodeInto(const Slice<uint8_t> bytes, ShardSet &set,
+                          const OnBlock &on_block,
+                          ThreadPool &pool = ThreadPool::shared()) const {
+    if (bytes.empty())
+      return Error::kPayloadSizeIsZero;
+    if (set.count() != wanted_n_ || set.shardLen() != shardLen(bytes.size()))
+      return Error::kInconsistentShardLengths;
 
-    for (size_t i = 0ull; i < bytes.size(); i += k2) {
-      const size_t chunk_idx = i / k2;
-      const auto end = std::min(i + k2, bytes.size());
-      assert(i != end);
+    encodeBlocks(
+        bytes, pool, format_,
+        [&](size_t shard, size_t first_col) {
+          return set[shard].data() + first_col * kSymbolBytes;
+        },
+        [&](size_t c0, size_t c1) {
+          on_block(c0 * kSymbolBytes, c1 * kSymbolBytes);
+        });
+    return true;
+  }
+
+  Result<bool> encodeInto(const Slice<uint8_t> bytes, ShardSet &set) const {
+    return encodeInto(bytes, set, [](size_t, size_t) {});
+  }
+
+  /// Compute the erasure root of the payload without materializing the
+  /// shards. Columns are encoded one block at a time into a single reusable
+  /// buffer and streamed into per-shard incremental hashers, so the peak
+  /// memory is `n` hash states plus one column block.
+  Result<Hash256> erasureRoot(const Slice<uint8_t> bytes,
+                              ThreadPool &pool = ThreadPool::shared()) {
+    if (bytes.empty())
+      return Error::kPayloadSizeIsZero;
+
+    const auto block_bytes = columnBlock() * kSymbolBytes;
+    std::vector<uint8_t> block(wanted_n_ * block_bytes);
+
+    auto hashes = encodeHashed(bytes, pool, [&](size_t shard, size_t) {
+      return block.data() + shard * block_bytes;
+    });
+    return ErasureTrie{std::move(hashes)}.root();
+  }
+
+  /// Check that a full set of shards forms a valid codeword, i.e. that the
+  /// parity shards are exactly what encoding the systematic ones yields.
+  /// Parity is re-derived column by column in scratch space and compared in
+  /// place, stopping at the first mismatching column. The payload is never
+  /// assembled.
+  /// @return false if some parity symbol does not match
+  Result<bool> verifyCodeword(const std::vector<Shard> &shards) const {
+    if (shards.size() < wanted_n_)
+      return Error::kNeedMoreShards;
+
+    const auto shard_len = shards[0].size();
+    if (shard_len == 0ull)
+      return Error::kEmptyShard;
+    for (size_t i = 0ull; i < wanted_n_; ++i)
+      if (shards[i].size() != shard_len || shard_len % kSymbolBytes != 0ull)
+        return Error::kInconsistentShardLengths;
+
+    auto &codeword = local();
+    codeword.resize(n_);
+    for (size_t c = 0ull; c < shard_len / kSymbolBytes; ++c) {
+      const auto offset = c * kSymbolBytes;
+      for (size_t i = 0ull; i < k_; ++i)
+        codeword[i] = Additive<typename TPolyEncoder::Descriptor>{
+            shardSymbol(&shards[i][offset])};
+      for (size_t i = k_; i < block_; ++i)
+        codeword[i] = Additive<typename TPolyEncoder::Descriptor>{0};
 
-      Slice<uint8_t> data_piece(&bytes[i], end - i);
-      assert(!data_piece.empty());
-      assert(data_piece.size() <= k2);
+      poly_enc_.encodeParitySymbols(codeword, n_, block_, block_,
+                                    position(wanted_n_));
+      for (size_t s = k_; s < wanted_n_; ++s)
+        if (shardSymbol(&shards[s][offset]) != codeword[position(s)].point_0)
+          return false;
+    }
+    return true;
+  }
+
+  /// Rewrites `shards` in place for the payload bytes at `offset` changing
+  /// from `old_bytes` to `new_bytes`. The code is linear, so each parity
+  /// shard changes by the encoding of the difference: only the columns the
+  /// range touches are encoded, and the cost follows the size of the edit,
+  /// not of the payload. Empty shards, those not held, are left empty.
+  /// @return `kUpdateOutOfRange` if the range runs past the shards
+  Result<bool> updateShards(std::vector<Shard> &shards, size_t offset,
+                            Slice<uint8_t> old_bytes,
+                            Slice<uint8_t> new_bytes) const {
+    if (shards.size() < wanted_n_)
+      return Error::kNeedMoreShards;
+    if (old_bytes.size() != new_bytes.size())
+      return Error::kUpdateLengthMismatch;
 
-      auto result = poly_enc_.encodeSub(local(), data_piece, n_, k_);
-      if (resultHasError(result)) {
-        return resultGetError(std::move(result));
+    size_t shard_len = 0ull;
+    for (size_t i = 0ull; i < wanted_n_; ++i)
+      if (!shards[i].empty()) {
+        if (shard_len != 0ull && shards[i].size() != shard_len)
+          return Error::kInconsistentShardLengths;
+        shard_len = shards[i].size();
       }
-      for (size_t val_idx = 0ull; val_idx < validator_count; ++val_idx) {
-        auto &shard = shards[val_idx];
-        const auto src = local()[val_idx].point_0;
-        TPolyEncoder::Descriptor::toBEBytes((uint8_t *)&shard[chunk_idx * 2ull],
-                                            src);
+    if (shard_len == 0ull)
+      return Error::kEmptyShard;
+    if (shard_len % kSymbolBytes != 0ull)
+      return Error::kInconsistentShardLengths;
+
+    const auto col_bytes = k_ * kSymbolBytes;
+    const auto size = new_bytes.size();
+    if (offset > shard_len * k_ || size > shard_len * k_ - offset)
+      return Error::kUpdateOutOfRange;
+    if (size == 0ull)
+      return true;
+
+    const auto swap = size_t(payloadSwap(format_));
+    for (size_t p = offset; p < offset + size; ++p) {
+      const auto symbol = p / kSymbolBytes;
+      auto &shard = shards[symbol % k_];
+      if (!shard.empty())
+        shard[symbol / k_ * kSymbolBytes + ((p % kSymbolBytes) ^ swap)] =
+            new_bytes[p - offset];
+    }
+
+    if (k_ == wanted_n_)
+      return true;
+    std::vector<uint8_t> delta(col_bytes);
+    auto &codeword = local();
+    for (size_t c = offset / col_bytes; c * col_bytes < offset + size; ++c) {
+      const auto first = std::max(offset, c * col_bytes);
+      const auto last = std::min(offset + size, c * col_bytes + col_bytes);
+      std::fill(delta.begin(), delta.end(), uint8_t(0));
+      for (size_t p = first; p < last; ++p)
+        delta[p - c * col_bytes] =
+            old_bytes[p - offset] ^ new_bytes[p - offset];
+
+      auto result = poly_enc_.encodeParitySub(
+          codeword, {delta.data(), delta.size()}, n_, block_, position(k_),
+          position(wanted_n_));
+      assert(!resultHasError(result));
+      for (size_t s = k_; s < wanted_n_; ++s) {
+        if (shards[s].empty())
+          continue;
+        auto *dst = &shards[s][c * kSymbolBytes];
+        const auto x = typename TPolyEncoder::Descriptor::Elt(
+            shardSymbol(dst) ^ codeword[position(s)].point_0);
+        copyShardSymbols(format_, dst, &x, 1ull);
       }
     }
-    return shards;
+    return true;
   }
 
   Result<std::vector<uint8_t>>
   reconstruct(const std::vector<Shard> &received_shards) {
-    const auto gap = math::sat_sub_unsigned(n_, received_shards.size());
+    return reconstructShards(received_shards);
+  }
 
-    size_t existential_count(0ull);
-    std::optional<size_t> first_shard_len;
-    for (size_t i = 0ull; i < std::min(n_, received_shards.size()); ++i) {
-      if (!received_shards[i].empty()) {
-        ++existential_count;
-        if (!first_shard_len)
-          first_shard_len = received_shards[i].size() / 2ull;
-        else if (*first_shard_len != received_shards[i].size() / 2ull)
+  /// Reconstruct several payloads that lost shards in the same places, e.g.
+  /// candidates of one height with the same validators unreachable. The
+  /// shards to decode from are chosen among those every payload has, the
+  /// error polynomial is evaluated once for that pattern, and the column
+  /// decodes of all payloads are spread across `pool`.
+  /// @return the payloads, in order, as `reconstruct` returns them
+  Result<std::vector<std::vector<uint8_t>>>
+  reconstructBatch(const std::vector<std::vector<Shard>> &batch,
+                   ThreadPool &pool = ThreadPool::shared()) {
+    constexpr size_t kTaskColumns = 256ull;
+    std::vector<std::vector<uint8_t>> payloads(batch.size());
+    if (batch.empty())
+      return payloads;
+
+    auto is_present = [&](size_t i) {
+      for (const auto &shards : batch)
+        if (i >= shards.size() || shards[i].empty())
+          return false;
+      return true;
+    };
+    size_t present = 0ull;
+    for (size_t i = 0ull; i < n_ - (block_ - k_); ++i)
+      present += is_present(i);
+    if (present < k_)
+      return Error::kNeedMoreShards;
+
+    std::vector<size_t> used;
+    const auto m = choosePrefix(
+        [&](size_t p) { return isZero(p) || is_present(shardAt(p)); },
+        n_, used);
+    const auto first_shard = *std::find_if(
+        used.begin(), used.end(), [&](size_t p) { return !isZero(p); });
+
+    std::vector<std::vector<Slice<const uint8_t>>> chosen(batch.size());
+    std::vector<std::vector<uint8_t>> zeros(batch.size());
+    std::vector<size_t> shard_lens(batch.size());
+    for (size_t p = 0ull; p < batch.size(); ++p) {
+      const auto first = atPosition(batch[p], first_shard, {});
+      shard_lens[p] = first.size() / kSymbolBytes;
+      if (block_ != k_)
+        zeros[p].resize(first.size());
+      chosen[p].resize(m);
+      for (const auto i : used) {
+        chosen[p][i] = atPosition(batch[p], i, zeros[p]);
+        if (chosen[p][i].size() / kSymbolBytes != shard_lens[p])
           return Error::kInconsistentShardLengths;
       }
+      payloads[p].resize(shard_lens[p] * kSymbolBytes * k_);
     }
 
-    if (existential_count < k_)
+    if (m == block_) {
+      pool.parallelFor(batch.size(), [&](size_t begin, size_t end) {
+        for (size_t p = begin; p < end; ++p)
+          interleaveSystematic(chosen[p], shard_lens[p], payloads[p].data());
+      });
+      return payloads;
+    }
+
+    auto error_poly = std::make_unique<ErrorPolynomial>();
+    poly_enc_.evalErrorPolynomial(chosen[0], 0ull, *error_poly,
+                                  TPolyEncoder::Descriptor::kFieldSize);
+
+    struct Task {
+      size_t payload, first_col, last_col;
+    };
+    std::vector<Task> tasks;
+    for (size_t p = 0ull; p < batch.size(); ++p)
+      for (size_t c = 0ull; c < shard_lens[p]; c += kTaskColumns)
+        tasks.push_back({p, c, std::min(shard_lens[p], c + kTaskColumns)});
+
+    pool.parallelFor(tasks.size(), [&](size_t begin, size_t end) {
+      auto &acc = localBytes();
+      for (size_t t = begin; t < end; ++t) {
+        const auto &task = tasks[t];
+        acc.clear();
+        decodeColumns(chosen[task.payload], m, *error_poly, task.first_col,
+                      task.last_col, acc);
+        memcpy(payloads[task.payload].data() +
+                   task.first_col * k_ * kSymbolBytes,
+               acc.data(), acc.size());
+      }
+    });
+    return payloads;
+  }
+
+  struct SubsetPayload {
+    std::vector<uint8_t> data;
+    /// Indices of the `k` shards the data was decoded from.
+    std::vector<size_t> subset;
+  };
+
+  /// Same as `reconstruct`, also reporting which shards were used. Out of
+  /// the received shards, all systematic ones are taken first and then the
+  /// parity ones that keep the decode transform smallest, so the more
+  /// shards arrive, the cheaper the decode gets.
+  Result<SubsetPayload>
+  reconstructWithSubset(const std::vector<Shard> &received_shards) {
+    SubsetPayload result;
+    auto data = reconstructShards(received_shards, &result.subset);
+    if (resultHasError(data))
+      return resultGetError(std::move(data));
+    result.data = resultGetValue(std::move(data));
+    return result;
+  }
+
+  struct CorrectedPayload {
+    std::vector<uint8_t> data;
+    /// Indices of the received shards that disagree with the decoded data.
+    std::vector<size_t> corrupted;
+  };
+
+  /// Reconstruct from more than `k` shards when some of them may be
+  /// silently corrupted. The redundancy beyond `k` is used to locate up to
+  /// `(received - k) / 2` inconsistent shards, which are then treated as
+  /// erasures in a single decode.
+  ///
+  /// Shards are located on one random linear combination of all columns, so
+  /// a corrupted shard goes unnoticed only if its errors cancel out in it
+  /// (about 1 in `Descriptor::kFieldSize`: 65536 over GF(2^16), 256 over
+  /// GF(2^8)). The decoded data is re-encoded and checked against every
+  /// received shard before it is returned, so a wrong result is never
+  /// reported as success.
+  /// @return data as `reconstruct` does, plus the indices of the shards that
+  /// were found corrupted
+  Result<CorrectedPayload>
+  reconstructCorrecting(const std::vector<Shard> &received_shards) {
+    using Descriptor = typename TPolyEncoder::Descriptor;
+    using Elt = typename Descriptor::Elt;
+
+    const auto count = std::min(n_ - (block_ - k_), received_shards.size());
+    auto is_received = [&](size_t i) {
+      return i < count && !received_shards[i].empty();
+    };
+
+    size_t received = 0ull;
+    size_t last = 0ull;
+    size_t shard_len = 0ull;
+    for (size_t i = 0ull; i < count; ++i) {
+      if (!is_received(i))
+        continue;
+      if (received++ == 0ull)
+        shard_len = received_shards[i].size() / kSymbolBytes;
+      else if (shard_len != received_shards[i].size() / kSymbolBytes)
+        return Error::kInconsistentShardLengths;
+      last = i + 1ull;
+    }
+    if (received < k_)
       return Error::kNeedMoreShards;
 
-    std::array<typename TPolyEncoder::Descriptor::Multiplier,
-               TPolyEncoder::Descriptor::kFieldSize>
-        error_poly_in_log = {0};
+    std::random_device seed;
+    std::mt19937 rng(seed());
+    std::uniform_int_distribution<uint32_t> pick_log(
+        0u, uint32_t(Descriptor::kOneMask) - 1u);
+    std::vector<typename Descriptor::Multiplier> fold(shard_len);
+    for (auto &f : fold)
+      f = typename Descriptor::Multiplier(pick_log(rng));
 
-    poly_enc_.evalErrorPolynomial(received_shards, gap, error_poly_in_log,
-                                  TPolyEncoder::Descriptor::kFieldSize);
-    const auto shard_len_in_syms = *first_shard_len;
+    const auto &tables = poly_enc_.descriptor().kTables;
+    std::vector<Elt> word(n_, Elt(0));
+    for (size_t i = 0ull; i < count; ++i) {
+      if (!is_received(i))
+        continue;
+      Elt acc(0);
+      for (size_t c = 0ull; c < shard_len; ++c)
+        acc ^= Additive<Descriptor>{
+            shardSymbol(&received_shards[i][c * kSymbolBytes])}
+                   .mul(fold[c], tables)
+                   .point_0;
+      word[position(i)] = acc;
+    }
 
-    std::vector<uint8_t> acc;
-    acc.reserve(shard_len_in_syms * 2ull * k_);
+    const auto located =
+        poly_enc_.locateErrors(word, n_, block_, [&](size_t p) {
+          return isZero(p) || is_received(shardAt(p));
+        });
+    if (!located)
+      return Error::kTooManyCorruptedShards;
 
-    local().clear();
-    local().reserve(received_shards.size());
+    std::vector<Slice<const uint8_t>> trusted(count);
+    for (size_t i = 0ull; i < count; ++i)
+      if (is_received(i))
+        trusted[i] = received_shards[i];
+    for (const auto p : *located)
+      if (!isZero(p))
+        trusted[shardAt(p)] = {};
 
-    for (size_t i = 0; i < shard_len_in_syms; ++i) {
-      local().clear();
+    auto decoded = reconstructShards(trusted);
+    if (resultHasError(decoded))
+      return resultGetError(std::move(decoded));
+    CorrectedPayload result{resultGetValue(std::move(decoded)), {}};
 
-      for (const auto &s : received_shards) {
-        if (s.empty())
-          local().emplace_back(Additive<typename TPolyEncoder::Descriptor>{0});
-        else
-          local().emplace_back(Additive<typename TPolyEncoder::Descriptor>{
-              TPolyEncoder::Descriptor::fromBEBytes(
-                  &s[i * sizeof(typename TPolyEncoder::Descriptor::Elt)])});
-      }
+    std::vector<bool> mismatch(count, false);
+    auto &codeword = local();
+    codeword.resize(n_);
+    for (size_t c = 0ull; c < shard_len; ++c) {
+      for (size_t i = 0ull; i < k_; ++i)
+        codeword[i] = Additive<Descriptor>{
+            Descriptor::fromBEBytes(&result.data[(c * k_ + i) * kSymbolBytes])};
+      for (size_t i = k_; i < block_; ++i)
+        codeword[i] = Additive<Descriptor>{0};
+      if (last > k_)
+        poly_enc_.encodeParitySymbols(codeword, n_, block_, block_,
+                                      position(last));
 
-      assert(local().size() + gap == n_);
-      auto result = poly_enc_.reconstructSub(acc, local(), received_shards, gap,
-                                             n_, k_, error_poly_in_log);
-      assert(!resultHasError(result));
+      for (size_t i = 0ull; i < last; ++i) {
+        if (!is_received(i))
+          continue;
+        const auto expected =
+            i < k_ ? Descriptor::fromBEBytes(
+                         &result.data[(c * k_ + i) * kSymbolBytes])
+                   : codeword[position(i)].point_0;
+        if (shardSymbol(&received_shards[i][c * kSymbolBytes]) != expected)
+          mismatch[i] = true;
+      }
     }
-    return acc;
+
+    for (size_t i = 0ull; i < count; ++i)
+      if (mismatch[i])
+        result.corrupted.push_back(i);
+    if (result.corrupted.size() > (received - k_) / 2)
+      return Error::kTooManyCorruptedShards;
+    return result;
   }
 
   /// Reconstruct from the set of systematic chunks.
@@ -142,57 +549,683 @@ template <typename TPolyEncoder> struct ReedSolomon final {
   /// the output to the expected byte length.
   Result<std::vector<uint8_t>>
   reconstruct_from_systematic(const std::vector<Shard> &chunks) {
-    if (chunks.empty()) {
-      return Error::kNeedMoreShards;
+    auto shard_len = systematicShardLen(chunks);
+    if (resultHasError(shard_len))
+      return resultGetError(std::move(shard_len));
+
+    std::vector<uint8_t> systematic_bytes;
+    systematic_bytes.resize(std::get<size_t>(shard_len) * kSymbolBytes * k_);
+    interleaveSystematic(chunks, std::get<size_t>(shard_len),
+                         systematic_bytes.data());
+    return systematic_bytes;
+  }
+
+  /// Same as `reconstruct_from_systematic`, writing exactly the first
+  /// `out.size()` bytes of the payload to `out`, so no padding is produced
+  /// and nothing is copied twice. With `pool`, the columns of payloads of a
+  /// megabyte and more are split across it.
+  /// @return `kOutputTooLong` if the chunks hold fewer than `out.size()`
+  /// bytes
+  Result<bool> reconstructFromSystematicInto(const std::vector<Shard> &chunks,
+                                             Slice<uint8_t> out,
+                                             ThreadPool *pool = nullptr) {
+    auto shard_len = systematicShardLen(chunks);
+    if (resultHasError(shard_len))
+      return resultGetError(std::move(shard_len));
+    if (out.size() > std::get<size_t>(shard_len) * kSymbolBytes * k_)
+      return Error::kOutputTooLong;
+
+    interleaveSystematic(chunks, out.data(), out.size(), pool);
+    return true;
+  }
+
+  using ErrorPolynomial =
+      std::array<typename TPolyEncoder::Descriptor::Multiplier,
+                 TPolyEncoder::Descriptor::kFieldSize>;
+
+  /// Erasure decode over the first `m` codeword positions, `m` being a power
+  /// of two with `2 * block <= m <= n`, for callers that track the erasure
+  /// pattern themselves. `shards` are indexed by position, the zero
+  /// positions holding present all-zero shards, and `error_poly` must be
+  /// the one `evalErrorPolynomial` gives for exactly the positions present
+  /// in `shards[0..m)`.
+  template <typename S>
+  std::vector<uint8_t> decodePrefix(const std::vector<S> &shards, size_t m,
+                                    const ErrorPolynomial &error_poly,
+                                    size_t shard_len_in_syms) const {
+    assert(math::isPowerOf2(m) && 2ull * block_ <= m && m <= n_);
+    assert(shards.size() >= m);
+
+    std::vector<uint8_t> acc;
+    acc.reserve(shard_len_in_syms * kSymbolBytes * k_);
+    decodeColumns(shards, m, error_poly, 0ull, shard_len_in_syms, acc);
+    return acc;
+  }
+
+  /// Appends the payload symbols of columns `[first_col, last_col)` to
+  /// `acc`, see `decodePrefix`.
+  template <typename S>
+  void decodeColumns(const std::vector<S> &shards, size_t m,
+                     const ErrorPolynomial &error_poly, size_t first_col,
+                     size_t last_col, std::vector<uint8_t> &acc) const {
+    if constexpr (kHasBitsliced)
+      if (bitsliced_) {
+        decodeColumnsBitsliced(shards, m, error_poly, first_col, last_col,
+                               acc);
+        return;
+      }
+    // the transpose reads a whole row of 8 symbols from each source
+    static constexpr uint8_t kZeros[8ull * kSymbolBytes] = {};
+    auto &tile = localTile();
+
+    for (size_t c0 = first_col; c0 < last_col; c0 += kTile) {
+      const auto cols = std::min(kTile, last_col - c0);
+      for (size_t t = 0ull; t < cols; ++t)
+        tile[t].resize(m);
+      withSwap(shardSwap(format_), [&](auto swap) {
+        transpose::transposeSymbols<kSymbolBytes, decltype(swap)::value>(
+            [&](size_t j, size_t t) -> const uint8_t * {
+              return shards[j].empty() ? kZeros
+                                       : &shards[j][(c0 + t) * kSymbolBytes];
+            },
+            m,
+            [&](size_t t, size_t j) {
+              return reinterpret_cast<uint8_t *>(&tile[t][j]);
+            },
+            cols);
+      });
+
+      for (size_t t = 0ull; t < cols; ++t) {
+        auto result = poly_enc_.reconstructSub(acc, tile[t], shards, 0ull, m,
+                                               block_, error_poly);
+        assert(!resultHasError(result));
+        acc.resize(acc.size() - (block_ - k_) * kSymbolBytes);
+      }
     }
-    auto &first_shard = chunks[0];
+  }
+
+  /// Writes the payload held by systematic shards `chunks[0..k)`, each of
+  /// `shard_len` symbols, to `out`.
+  template <typename S>
+  void interleaveSystematic(const std::vector<S> &chunks, size_t shard_len,
+                            uint8_t *out) const {
+    interleaveSystematic(chunks, out, shard_len * kSymbolBytes * k_);
+  }
+
+  /// Writes the first `size` bytes of the payload held by systematic shards
+  /// `chunks[0..k)` to `out`. Whole columns are transposed in tiles of
+  /// `transpose::kTileColumns` columns by `kInterleaveRows` shards, a tile
+  /// reading one cache line of each of its shards; with `pool` the columns
+  /// are split across it once there are `kParallelBytes` of them.
+  template <typename S>
+  void interleaveSystematic(const std::vector<S> &chunks, uint8_t *out,
+                            size_t size, ThreadPool *pool = nullptr) const {
+    constexpr size_t kInterleaveRows = 64ull;
+    constexpr size_t kParallelBytes = 1ull << 20;
+    // Locals, as the byte stores to `out` may alias any member.
+    const auto k = k_;
+    const auto col_bytes = k * kSymbolBytes;
+    const auto full_cols = size / col_bytes;
 
-    if (chunks.size() < k_) {
+    std::vector<const uint8_t *> rows(k);
+    for (size_t r = 0ull; r < k; ++r)
+      rows[r] = &chunks[r][0];
+
+    auto columns = [&](size_t first, size_t last) {
+      withSwap(payloadSwap(format_), [&](auto swap) {
+        for (size_t c0 = first; c0 < last;
+             c0 += transpose::kTileColumns) {
+          const auto c1 = std::min(last, c0 + transpose::kTileColumns);
+          for (size_t r0 = 0ull; r0 < k; r0 += kInterleaveRows) {
+            const auto *const *src = rows.data() + r0;
+            auto *dst = out + c0 * col_bytes + r0 * kSymbolBytes;
+            transpose::transposeSymbols<kSymbolBytes, decltype(swap)::value>(
+                [=](size_t r, size_t c) {
+                  return src[r] + (c0 + c) * kSymbolBytes;
+                },
+                std::min(kInterleaveRows, k - r0),
+                [=](size_t c, size_t r) {
+                  return dst + c * col_bytes + r * kSymbolBytes;
+                },
+                c1 - c0);
+          }
+        }
+      });
+    };
+    if (pool && size >= kParallelBytes)
+      pool->parallelFor(full_cols, columns, transpose::kTileColumns);
+    else
+      columns(0ull, full_cols);
+
+    const auto swap = payloadSwap(format_);
+    for (size_t b = full_cols * col_bytes; b < size; ++b) {
+      const auto r = (b - full_cols * col_bytes) / kSymbolBytes;
+      out[b] = chunks[r][full_cols * kSymbolBytes +
+                         ((b % kSymbolBytes) ^ size_t(swap))];
+    }
+  }
+
+  const TPolyEncoder &polyEncoder() const { return poly_enc_; }
+
+  /// Return the number of shards `encode` produces.
+  size_t wantedN() const { return wanted_n_; }
+
+  /// Return the computed `n` value.
+  size_t n() const { return n_; }
+
+  /// Return the computed `k` value, the number of shards holding the
+  /// payload and needed to recover it.
+  size_t k() const { return k_; }
+
+  /// Return the transform block, a power of two: `k` itself in `kV1`, `k`
+  /// rounded up in `kV2`.
+  size_t block() const { return block_; }
+
+  CodeVersion version() const { return version_; }
+
+  /// Return the codeword position of shard `shard`. The payload shards take
+  /// `[0, k)` and the parity ones follow the zero positions `[k, block)`.
+  size_t position(size_t shard) const {
+    return shard < k_ ? shard : shard + (block_ - k_);
+  }
+
+  /// What a decode reads: the `block` shards it is taken from, by codeword
+  /// position, and the codeword prefix it runs over.
+  struct DecodePlan {
+    /// Size of the prefix, `block` when the chosen shards are exactly the
+    /// systematic ones and the payload is a plain interleave of them.
+    size_t m = 0ull;
+    /// Symbols per shard.
+    size_t shard_len = 0ull;
+    /// The chosen shards by position, the others being empty.
+    std::vector<Slice<const uint8_t>> chosen;
+    /// Indices of the shards the data is taken from.
+    std::vector<size_t> subset;
+    /// Error polynomial of the chosen positions, unless `m` is `block`.
+    std::unique_ptr<ErrorPolynomial> error_poly;
+    /// Backs the zero positions of a `kV2` code.
+    std::vector<uint8_t> zeros;
+  };
+
+  /// Chooses the cheapest `k` of the received shards. The systematic ones
+  /// are taken first and then the lowest parity ones, the decode running
+  /// over the smallest power-of-two prefix of the codeword holding them.
+  /// The plan views `received_shards`, which must outlive it, and decodes
+  /// column by column with `decodeColumns` or, when `m` is `block`, with
+  /// `interleaveSystematic`.
+  template <typename S>
+  Result<DecodePlan> planDecode(const std::vector<S> &received_shards) const {
+    const auto count = std::min(n_ - (block_ - k_), received_shards.size());
+
+    size_t existential_count(0ull);
+    std::optional<size_t> first_shard_len;
+    for (size_t i = 0ull; i < count; ++i) {
+      if (!received_shards[i].empty()) {
+        ++existential_count;
+        if (!first_shard_len)
+          first_shard_len = received_shards[i].size() / kSymbolBytes;
+        else if (*first_shard_len != received_shards[i].size() / kSymbolBytes)
+          return Error::kInconsistentShardLengths;
+      }
+    }
+
+    if (existential_count < k_)
       return Error::kNeedMoreShards;
+
+    DecodePlan plan;
+    plan.shard_len = *first_shard_len;
+    plan.zeros.resize(block_ != k_ ? plan.shard_len * kSymbolBytes : 0ull);
+    std::vector<size_t> used;
+    plan.m = choosePrefix(
+        [&](size_t p) {
+          return isZero(p) || !received_shards[shardAt(p)].empty();
+        },
+        position(count), used);
+
+    plan.chosen.resize(plan.m);
+    for (const auto p : used) {
+      plan.chosen[p] = atPosition(received_shards, p, plan.zeros);
+      if (!isZero(p))
+        plan.subset.push_back(shardAt(p));
     }
 
-    const auto shard_len = first_shard.size() / 2;
-    if (shard_len == 0) {
-      return Error::kEmptyShard;
+    if (plan.m != block_) {
+      plan.error_poly = std::make_unique<ErrorPolynomial>();
+      poly_enc_.evalErrorPolynomial(plan.chosen, 0ull, *plan.error_poly,
+                                    TPolyEncoder::Descriptor::kFieldSize);
+    }
+    return plan;
+  }
+
+  /// Writes columns `[first_col, last_col)` of every shard, for callers
+  /// streaming the payload in column groups. `segments[i]` receives
+  /// `kSymbolBytes` bytes per column of shard `i`, in the selected format.
+  void encodeColumnRange(const Slice<uint8_t> bytes, size_t first_col,
+                         size_t last_col, uint8_t *const *segments) const {
+    encodeColumns(bytes, first_col, last_col, segments, 0ull, wanted_n_,
+                  format_);
+  }
+
+  /// Return the length in bytes of the shards of a payload of
+  /// `payload_size` bytes.
+  size_t shardLen(size_t payload_size) const {
+    const auto payload_symbols =
+        (payload_size + kSymbolBytes - 1) / kSymbolBytes;
+    const auto shard_symbols_ceil = (payload_symbols + k_ - 1) / k_;
+    const auto shard_bytes = shard_symbols_ceil * kSymbolBytes;
+    return shard_bytes;
+  }
+
+private:
+  ReedSolomon(size_t n, size_t k, size_t block, size_t wanted_n,
+              const TPolyEncoder &poly_enc, CodeVersion version)
+      : n_(n), k_(k), block_(block), wanted_n_(wanted_n), poly_enc_(poly_enc),
+        version_(version) {}
+
+  /// Whether codeword position `p` is one of the zero positions
+  /// `[k, block)`, which no shard holds.
+  bool isZero(size_t p) const { return p >= k_ && p < block_; }
+
+  /// Shard at codeword position `p`, the inverse of `position`.
+  size_t shardAt(size_t p) const {
+    assert(!isZero(p));
+    return p < k_ ? p : p - (block_ - k_);
+  }
+
+  /// Shard at codeword position `p` of `shards`, which are indexed by shard.
+  /// The zero positions read as `zeros`.
+  template <typename S>
+  Slice<const uint8_t> atPosition(const std::vector<S> &shards, size_t p,
+                                  Slice<const uint8_t> zeros) const {
+    if (isZero(p))
+      return zeros;
+    const auto i = shardAt(p);
+    if (i >= shards.size())
+      return {};
+    return {shards[i].data(), shards[i].size()};
+  }
+
+  /// Picks the `block` codeword positions a decode reads out of those
+  /// `is_present` among `[0, count)`: the systematic ones first, then the
+  /// lowest parity ones. The zero positions count as present, so `k` shards
+  /// must be.
+  /// @return size of the codeword prefix the decode runs over, `block` when
+  /// the chosen shards are exactly the systematic ones
+  template <typename IsPresent>
+  size_t choosePrefix(const IsPresent &is_present, size_t count,
+                      std::vector<size_t> &used) const {
+    size_t m = block_;
+    used.clear();
+    used.reserve(block_);
+    for (size_t i = 0ull; i < count && used.size() < block_; ++i) {
+      if (i == m)
+        m *= 2ull;
+      if (is_present(i))
+        used.push_back(i);
     }
+    assert(used.size() == block_);
+    return m;
+  }
 
-    for (const auto &c : chunks) {
-      const auto length = c.size() / 2;
-      if (length != shard_len) {
+  /// Symbols per shard of a set of systematic chunks, checking there are at
+  /// least `k` of them, of one length.
+  Result<size_t> systematicShardLen(const std::vector<Shard> &chunks) const {
+    if (chunks.empty() || chunks.size() < k_)
+      return Error::kNeedMoreShards;
+
+    const auto shard_len = chunks[0].size() / kSymbolBytes;
+    if (shard_len == 0)
+      return Error::kEmptyShard;
+    for (const auto &c : chunks)
+      if (c.size() / kSymbolBytes != shard_len)
         return Error::kInconsistentShardLengths;
+    return shard_len;
+  }
+
+  std::vector<uint8_t> &localBytes() const {
+    thread_local std::vector<uint8_t> bytes;
+    return bytes;
+  }
+
+  /// Erasure decode from the cheapest `k` of the received shards, see
+  /// `planDecode`. `S` is any shard type with `empty()`, `size()` and byte
+  /// indexing, so callers can pass views with some shards blanked out.
+  /// @param subset receives the indices of the shards the data was taken from
+  template <typename S>
+  Result<std::vector<uint8_t>>
+  reconstructShards(const std::vector<S> &received_shards,
+                    std::vector<size_t> *subset = nullptr) {
+    auto planned = planDecode(received_shards);
+    if (resultHasError(planned))
+      return resultGetError(std::move(planned));
+    const auto plan = resultGetValue(std::move(planned));
+    if (subset)
+      *subset = plan.subset;
+
+    std::vector<uint8_t> acc;
+    if (plan.m == block_) {
+      acc.resize(plan.shard_len * kSymbolBytes * k_);
+      interleaveSystematic(plan.chosen, plan.shard_len, acc.data());
+      return acc;
+    }
+    return decodePrefix(plan.chosen, plan.m, *plan.error_poly,
+                        plan.shard_len);
+  }
+
+  Result<std::vector<Shard>> encodeShards(const Slice<uint8_t> bytes,
+                                          size_t first_shard,
+                                          size_t last_shard) const {
+    const auto shard_len = shardLen(bytes.size());
+    assert(shard_len > 0);
+
+    std::vector<Shard> shards;
+    shards.assign(last_shard - first_shard, Shard(shard_len));
+
+    std::vector<uint8_t *> segments(shards.size());
+    for (size_t i = 0ull; i < shards.size(); ++i)
+      segments[i] = shards[i].data();
+
+    encodeColumns(bytes, 0ull, shard_len / kSymbolBytes, segments.data(),
+                  first_shard, last_shard, format_);
+    return shards;
+  }
+
+  /// Writes columns `[first_col, last_col)` of shards
+  /// `[first_shard, last_shard)`. `segments[i]` receives two bytes per column
+  /// of shard `first_shard + i`, in `format`.
+  void encodeColumns(const Slice<uint8_t> bytes, size_t first_col,
+                     size_t last_col, uint8_t *const *segments,
+                     size_t first_shard, size_t last_shard,
+                     ShardFormat format) const {
+    assert(first_shard <= last_shard && last_shard <= wanted_n_);
+    const auto col_bytes = k_ * kSymbolBytes;
+
+    if (first_shard < k_) {
+      const auto rows = std::min(k_, last_shard) - first_shard;
+      const auto full_cols =
+          std::clamp(bytes.size() / col_bytes, first_col, last_col);
+
+      const auto swap_payload = payloadSwap(format);
+      if (full_cols > first_col)
+        withSwap(swap_payload, [&](auto swap) {
+          transpose::deinterleaveSymbols<kSymbolBytes, decltype(swap)::value>(
+              &bytes[first_col * col_bytes], k_, full_cols - first_col,
+              first_shard, rows, segments);
+        });
+      for (size_t c = full_cols; c < last_col; ++c)
+        for (size_t r = 0ull; r < rows; ++r) {
+          const auto offset = c * col_bytes + (first_shard + r) * kSymbolBytes;
+          auto *dst = segments[r] + (c - first_col) * kSymbolBytes;
+          for (size_t b = 0ull; b < kSymbolBytes; ++b)
+            dst[b ^ size_t(swap_payload)] =
+                offset + b < bytes.size() ? bytes[offset + b] : 0;
+        }
+    }
+
+    const auto first_parity = std::max(k_, first_shard);
+    if (first_parity >= last_shard)
+      return;
+    const auto first_pos = position(first_parity);
+    const auto last_pos = position(last_shard);
+    if constexpr (kHasBitsliced)
+      if (bitsliced_) {
+        encodeColumnsBitsliced(bytes, first_col, last_col, segments,
+                               first_shard, first_parity, last_shard, format);
+        return;
       }
+
+    auto &tile = localTile();
+    for (size_t c0 = first_col; c0 < last_col; c0 += kTile) {
+      const auto cols = std::min(kTile, last_col - c0);
+      for (size_t t = 0ull; t < cols; ++t) {
+        const auto i = (c0 + t) * col_bytes;
+        assert(i < bytes.size());
+        const auto end = std::min(i + col_bytes, bytes.size());
+
+        auto result =
+            poly_enc_.encodeParitySub(tile[t], bytes.subspan(i, end - i), n_,
+                                      block_, first_pos, last_pos);
+        assert(!resultHasError(result));
+      }
+
+      withSwap(shardSwap(format), [&](auto swap) {
+        transpose::transposeSymbols<kSymbolBytes, decltype(swap)::value>(
+            [&](size_t t, size_t s) {
+              return reinterpret_cast<const uint8_t *>(
+                  &tile[t][first_pos + s]);
+            },
+            cols,
+            [&](size_t s, size_t t) {
+              return segments[first_parity - first_shard + s] +
+                     (c0 - first_col + t) * kSymbolBytes;
+            },
+            last_shard - first_parity);
+      });
     }
+  }
 
-    std::vector<uint8_t> systematic_bytes;
-    systematic_bytes.resize(shard_len * 2 * k_);
-
-    uint8_t *ptr = &systematic_bytes[0];
-    for (size_t i = 0; i < shard_len; ++i) {
-      for (size_t y = 0; y < k_; ++y) {
-        const uint8_t *chunk = &chunks[y][i * 2];
-        ptr[0] = chunk[0];
-        ptr[1] = chunk[1];
-        ptr += 2;
+  /// Parity part of `encodeColumns` on the bit-sliced engine.
+  void encodeColumnsBitsliced(const Slice<uint8_t> bytes, size_t first_col,
+                              size_t last_col, uint8_t *const *segments,
+                              size_t first_shard, size_t first_parity,
+                              size_t last_shard, ShardFormat format) const {
+    constexpr auto kLanes = bitsliced::kLanes;
+    const auto k2 = k_ * 2ull;
+    auto &words = localWords();
+    words.resize(n_);
+    uint16_t rows[8][kLanes];
+
+    for (size_t c = first_col; c < last_col; c += kLanes) {
+      const auto lanes = std::min(kLanes, last_col - c);
+      const auto full = lanes == kLanes && (c + kLanes) * k2 <= bytes.size();
+      for (size_t r0 = 0ull; r0 < k_; r0 += 8ull) {
+        const auto count = std::min(size_t(8ull), k_ - r0);
+        if (full) {
+          transpose::transpose16<transpose::kSwapBE>(
+              [&](size_t t, size_t r) {
+                return &bytes[0] + (c + t) * k2 + (r0 + r) * 2ull;
+              },
+              kLanes,
+              [&](size_t r, size_t t) {
+                return reinterpret_cast<uint8_t *>(&rows[r][t]);
+              },
+              count);
+        } else {
+          for (size_t r = 0ull; r < count; ++r)
+            for (size_t t = 0ull; t < kLanes; ++t) {
+              const auto offset = ((c + t) * k_ + r0 + r) * 2ull;
+              uint8_t be[2] = {0, 0};
+              if (t < lanes && offset < bytes.size()) {
+                be[0] = bytes[offset];
+                be[1] =
+                    offset + 1ull < bytes.size() ? bytes[offset + 1ull] : 0;
+              }
+              rows[r][t] = TPolyEncoder::Descriptor::fromBEBytes(be);
+            }
+        }
+        for (size_t r = 0ull; r < count; ++r)
+          bitsliced::pack(rows[r], words[r0 + r]);
+      }
+      for (size_t r = k_; r < block_; ++r)
+        words[r] = bitsliced::Word{};
+
+      bitsliced_->encodeParity(words.data(), block_, position(first_parity),
+                               position(last_shard));
+
+      for (size_t s = first_parity; s < last_shard; ++s) {
+        bitsliced::unpack(words[position(s)], rows[0]);
+        copyShardSymbols(format,
+                         segments[s - first_shard] + (c - first_col) * 2ull,
+                         rows[0], lanes);
       }
     }
-    return systematic_bytes;
   }
 
-  /// Return the computed `n` value.
-  size_t n() const { return n_; }
+  /// `decodeColumns` on the bit-sliced engine.
+  template <typename S>
+  void decodeColumnsBitsliced(const std::vector<S> &shards, size_t m,
+                              const ErrorPolynomial &error_poly,
+                              size_t first_col, size_t last_col,
+                              std::vector<uint8_t> &acc) const {
+    constexpr auto kLanes = bitsliced::kLanes;
+    std::vector<bool> present(m);
+    std::vector<bitsliced::Matrix> error(m);
+    for (size_t i = 0ull; i < m; ++i) {
+      present[i] = !shards[i].empty();
+      if (present[i] || i < block_)
+        error[i] = bitsliced_->matrix(error_poly[i]);
+    }
 
-  /// Return the computed `k` value.
-  size_t k() const { return k_; }
+    auto &words = localWords();
+    words.resize(m);
+    uint16_t rows[8][kLanes] = {};
 
-private:
-  ReedSolomon(size_t n, size_t k, size_t wanted_n, const TPolyEncoder &poly_enc)
-      : n_(n), k_(k), wanted_n_(wanted_n), poly_enc_(poly_enc) {}
+    for (size_t c = first_col; c < last_col; c += kLanes) {
+      const auto lanes = std::min(kLanes, last_col - c);
+      for (size_t i = 0ull; i < m; ++i) {
+        if (!present[i]) {
+          words[i] = bitsliced::Word{};
+          continue;
+        }
+        copyShardSymbols(format_, rows[0], &shards[i][c * 2ull], lanes);
+        bitsliced::pack(rows[0], words[i]);
+      }
 
-  size_t shardLen(size_t payload_size) {
-    const auto payload_symbols = (payload_size + 1) / 2;
-    const auto shard_symbols_ceil = (payload_symbols + k_ - 1) / k_;
-    const auto shard_bytes = shard_symbols_ceil * 2;
-    return shard_bytes;
+      bitsliced_->decode(words.data(), m, block_, present, error);
+
+      const auto was = acc.size();
+      acc.resize(was + lanes * k_ * 2ull);
+      for (size_t i0 = 0ull; i0 < k_; i0 += 8ull) {
+        const auto count = std::min(size_t(8ull), k_ - i0);
+        for (size_t r = 0ull; r < count; ++r) {
+          if (present[i0 + r])
+            copyShardSymbols(format_, rows[r], &shards[i0 + r][c * 2ull],
+                             lanes);
+          else
+            bitsliced::unpack(words[i0 + r], rows[r]);
+        }
+        transpose::transpose16<transpose::kSwapBE>(
+            [&](size_t r, size_t t) {
+              return reinterpret_cast<const uint8_t *>(&rows[r][t]);
+            },
+            count,
+            [&](size_t t, size_t r) {
+              return &acc[was + (t * k_ + i0 + r) * 2ull];
+            },
+            lanes);
+      }
+    }
+  }
+
+  /// Whether symbols are byte swapped between shards in `format` and the
+  /// codeword. Single byte symbols never are.
+  static bool shardSwap(ShardFormat format) {
+    return format == ShardFormat::kBigEndian && transpose::kSwapBE &&
+           kSymbolBytes > 1ull;
+  }
+
+  /// Whether symbols are byte swapped between the payload, whose byte pairs
+  /// are big-endian symbols, and shards in `format`.
+  static bool payloadSwap(ShardFormat format) {
+    return format == ShardFormat::kNative && transpose::kSwapBE &&
+           kSymbolBytes > 1ull;
+  }
+
+  /// Calls `f` with `swap` as a `std::bool_constant`, for the kernels that
+  /// take it as a template argument.
+  template <typename F> static void withSwap(bool swap, const F &f) {
+    if (swap)
+      f(std::true_type{});
+    else
+      f(std::false_type{});
+  }
+
+  /// Copies `count` symbols between shards in `format` and native memory,
+  /// either way.
+  static void copyShardSymbols(ShardFormat format, void *dst, const void *src,
+                               size_t count) {
+    withSwap(shardSwap(format), [&](auto swap) {
+      transpose::copySymbols<kSymbolBytes, decltype(swap)::value>(dst, src,
+                                                                  count);
+    });
+  }
+
+  typename TPolyEncoder::Descriptor::Elt shardSymbol(const uint8_t *p) const {
+    typename TPolyEncoder::Descriptor::Elt x;
+    copyShardSymbols(format_, &x, p, 1ull);
+    return x;
+  }
+
+  std::vector<bitsliced::Word> &localWords() const {
+    thread_local std::vector<bitsliced::Word> words;
+    return words;
+  }
+
+  /// Encodes the payload in blocks of `columnBlock()` columns and hashes the
+  /// shards incrementally. Shard `i` of the block starting at column `c0` is
+  /// written to `segment_of(i, c0)` and fed to its hasher once the whole
+  /// block is encoded.
+  template <typename SegmentOf>
+  std::vector<Hash256> encodeHashed(const Slice<uint8_t> bytes,
+                                    ThreadPool &pool,
+                                    const SegmentOf &segment_of) const {
+    std::vector<Blake2b> hashers(wanted_n_, Blake2b(sizeof(Hash256)));
+    encodeBlocks(bytes, pool, ShardFormat::kBigEndian, segment_of,
+                 [&](size_t c0, size_t c1) {
+                   pool.parallelFor(wanted_n_, [&](size_t begin, size_t end) {
+                     for (size_t i = begin; i < end; ++i)
+                       hashers[i].update(segment_of(i, c0),
+                                         (c1 - c0) * kSymbolBytes);
+                   });
+                 });
+
+    std::vector<Hash256> hashes(wanted_n_);
+    for (size_t i = 0ull; i < wanted_n_; ++i)
+      hashers[i].finalize(hashes[i].data());
+    return hashes;
+  }
+
+  /// Encodes the payload in blocks of `columnBlock()` columns, in `format`,
+  /// spreading each block across `pool`. Shard `i` of the block starting at
+  /// column `c0` is written to `segment_of(i, c0)`, and `on_block(c0, c1)`
+  /// is called once the whole block is encoded.
+  template <typename SegmentOf, typename OnBlock>
+  void encodeBlocks(const Slice<uint8_t> bytes, ThreadPool &pool,
+                    ShardFormat format, const SegmentOf &segment_of,
+                    const OnBlock &on_block) const {
+    const auto columns = shardLen(bytes.size()) / kSymbolBytes;
+    const auto block = columnBlock();
+
+    for (size_t c0 = 0ull; c0 < columns; c0 += block) {
+      const auto c1 = std::min(columns, c0 + block);
+      pool.parallelFor(
+          c1 - c0,
+          [&](size_t begin, size_t end) {
+            auto &segments = localSegments();
+            for (size_t i = 0ull; i < wanted_n_; ++i)
+              segments[i] = segment_of(i, c0) + begin * kSymbolBytes;
+            encodeColumns(bytes, c0 + begin, c0 + end, segments.data(), 0ull,
+                          wanted_n_, format);
+          },
+          transpose::kTileColumns);
+      on_block(c0, c1);
+    }
+  }
+
+  /// Columns per block of the fused encode passes: a whole number of
+  /// BLAKE2b blocks per shard, about `kColumnBlockBytes` across all shards.
+  size_t columnBlock() const {
+    constexpr size_t kColumnBlockBytes = 1ull << 18;
+    constexpr size_t kHashBlockColumns = Blake2b::kBlockSize / kSymbolBytes;
+    const auto columns = kColumnBlockBytes / (wanted_n_ * kSymbolBytes);
+    return std::max(kHashBlockColumns,
+                    columns / kHashBlockColumns * kHashBlockColumns);
+  }
+
+  std::vector<uint8_t *> &localSegments() const {
+    thread_local std::vector<uint8_t *> segments;
+    segments.resize(wanted_n_);
+    return segments;
   }
 
   std::vector<Additive<typename TPolyEncoder::Descriptor>> &local() const {
@@ -200,10 +1233,26 @@ private:
     return data;
   }
 
+  /// Columns the log/exp engine transforms before moving them between the
+  /// shard and codeword layouts in one `transpose::transposeSymbols` pass.
+  static constexpr size_t kTile = 8ull;
+
+  std::vector<std::vector<Additive<typename TPolyEncoder::Descriptor>>> &
+  localTile() const {
+    thread_local std::vector<
+        std::vector<Additive<typename TPolyEncoder::Descriptor>>>
+        tile(kTile);
+    return tile;
+  }
+
   const size_t n_;
   const size_t k_;
+  const size_t block_;
   const size_t wanted_n_;
   const TPolyEncoder &poly_enc_;
+  const CodeVersion version_;
+  std::shared_ptr<const BitslicedEngine<TPolyEncoder>> bitsliced_;
+  ShardFormat format_ = ShardFormat::kBigEndian;
 };
 
 } // namespace ec_cpp
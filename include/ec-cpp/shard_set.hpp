@@ -0,0 +1,80 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_SHARD_SET_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_SHARD_SET_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+#include <ec-cpp/types.hpp>
+
+namespace ec_cpp {
+
+/// The shards of one payload in a single page-aligned allocation, shard `i`
+/// taking bytes `[i * shardLen(), (i + 1) * shardLen())`. Being one region,
+/// it is what a `ShardWriter` registers with the kernel for its writes.
+class ShardSet final {
+public:
+  static constexpr size_t kAlignment = 4096ull;
+
+  ShardSet() = default;
+  ShardSet(size_t count, size_t shard_len)
+      : count_{count}, shard_len_{shard_len},
+        data_{allocate(count * shard_len)} {}
+
+  size_t count() const { return count_; }
+
+  /// Return the length in bytes of every shard.
+  size_t shardLen() const { return shard_len_; }
+
+  uint8_t *data() { return data_.get(); }
+  const uint8_t *data() const { return data_.get(); }
+
+  /// Return the bytes of all the shards.
+  size_t size() const { return count_ * shard_len_; }
+
+  Slice<uint8_t> operator[](size_t i) {
+    return {data_.get() + i * shard_len_, shard_len_};
+  }
+  Slice<const uint8_t> operator[](size_t i) const {
+    return {data_.get() + i * shard_len_, shard_len_};
+  }
+
+  /// Copies the shards out, as `ReedSolomon::encode` returns them.
+  std::vector<std::vector<uint8_t>> toShards() const {
+    std::vector<std::vector<uint8_t>> shards(count_);
+    for (size_t i = 0ull; i < count_; ++i)
+      shards[i].assign((*this)[i].begin(), (*this)[i].end());
+    return shards;
+  }
+
+private:
+  struct Free {
+    void operator()(uint8_t *p) const { ::free(p); }
+  };
+
+  static uint8_t *allocate(size_t size) {
+    if (size == 0ull)
+      return nullptr;
+    auto *p = static_cast<uint8_t *>(::aligned_alloc(
+        kAlignment, (size + kAlignment - 1ull) / kAlignment * kAlignment));
+    if (!p)
+      throw std::bad_alloc();
+    return p;
+  }
+
+  size_t count_ = 0ull;
+  size_t shard_len_ = 0ull;
+  std::unique_ptr<uint8_t, Free> data_;
+};
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_SHARD_SET_HPP
@@ -0,0 +1,639 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_SHARD_WRITER_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_SHARD_WRITER_HPP
+
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdlib.h>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <ec-cpp/errors.hpp>
+#include <ec-cpp/shard_set.hpp>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define EC_CPP_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#else
+#define EC_CPP_IO_URING 0
+#endif
+
+namespace ec_cpp {
+
+/// How a `ShardWriter` submits its writes.
+enum class WriteBackend {
+  /// One io_uring instance, writing from the registered `ShardSet` where
+  /// the kernel takes it.
+  kIoUring,
+  /// Worker threads calling `pwritev`.
+  kThreads,
+};
+
+namespace detail {
+
+#if EC_CPP_IO_URING
+
+/// The part of io_uring the writer uses: one submission ring filled and one
+/// completion ring drained under the caller's lock.
+class IoUring final {
+public:
+  /// @return nullptr when the kernel has no io_uring, or one older than the
+  /// plain read and write opcodes and waits with a timeout
+  static std::unique_ptr<IoUring> create(unsigned entries) {
+    io_uring_params params{};
+    const auto fd = int(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0)
+      return nullptr;
+    std::unique_ptr<IoUring> ring{new IoUring(fd, params)};
+    constexpr auto kFeatures = IORING_FEAT_RW_CUR_POS | IORING_FEAT_EXT_ARG;
+    if ((params.features & kFeatures) != kFeatures || !ring->map())
+      return nullptr;
+    return ring;
+  }
+
+  ~IoUring() {
+    if (sqes_)
+      ::munmap(sqes_, sqes_size_);
+    if (cq_ring_ && cq_ring_ != sq_ring_)
+      ::munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_)
+      ::munmap(sq_ring_, sq_ring_size_);
+    ::close(fd_);
+  }
+
+  unsigned entries() const { return params_.sq_entries; }
+
+  /// Next free submission entry, zeroed.
+  io_uring_sqe *sqe() {
+    const auto head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sq_tail_ - head >= *sq_entries_)
+      return nullptr;
+    const auto index = sq_tail_ & *sq_mask_;
+    sq_array_[index] = index;
+    ++sq_tail_;
+    ++to_submit_;
+    auto *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+  }
+
+  /// Hands the queued entries to the kernel.
+  /// @return 0, or the errno of the `io_uring_enter` that stopped short;
+  /// EAGAIN and EBUSY mean the kernel is out of room for now
+  int submit() {
+    __atomic_store_n(sq_ktail_, sq_tail_, __ATOMIC_RELEASE);
+    while (to_submit_ != 0u) {
+      const auto submitted = enter(to_submit_, 0u, 0u);
+      if (submitted < 0 && errno == EINTR)
+        continue;
+      if (submitted < 0)
+        return errno;
+      if (submitted == 0)
+        return EAGAIN;
+      to_submit_ -= unsigned(submitted);
+    }
+    return 0;
+  }
+
+  /// Takes back the entries a failed `submit` left, calling `f(user_data)`
+  /// on each. The kernel only reads the ring inside `submit`.
+  template <typename F> void withdraw(const F &f) {
+    auto head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    const auto tail = sq_tail_;
+    sq_tail_ = head;
+    to_submit_ = 0u;
+    __atomic_store_n(sq_ktail_, sq_tail_, __ATOMIC_RELEASE);
+    for (; head != tail; ++head)
+      f(sqes_[sq_array_[head & *sq_mask_]].user_data);
+  }
+
+  /// Waits up to `timeout_ns` for a completion.
+  /// @return false when the ring cannot be waited on any more
+  bool wait(int64_t timeout_ns) {
+    __kernel_timespec ts{timeout_ns / 1000000000, timeout_ns % 1000000000};
+    io_uring_getevents_arg arg{};
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = uint64_t(uintptr_t(&ts));
+    const auto entered = int(::syscall(
+        __NR_io_uring_enter, fd_, 0u, 1u,
+        IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)));
+    return entered >= 0 || errno == EINTR || errno == ETIME ||
+           errno == EAGAIN || errno == EBUSY;
+  }
+
+  /// Moves the completions the kernel kept back while the ring was full
+  /// into it, without waiting.
+  void poll() { enter(0u, 0u, IORING_ENTER_GETEVENTS); }
+
+  /// Calls `f(user_data, res)` on each completion in the ring. The entries
+  /// are consumed before `f` sees them, so `f` may submit and drain again.
+  /// @return the completions seen
+  template <typename F> size_t drain(const F &f) {
+    constexpr size_t kBatch = 64ull;
+    size_t drained = 0ull;
+    for (;;) {
+      std::pair<uint64_t, int> batch[kBatch];
+      size_t n = 0ull;
+      auto head = *cq_head_;
+      const auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      for (; head != tail && n < kBatch; ++head, ++n) {
+        const auto &cqe = cqes_[head & *cq_mask_];
+        batch[n] = {cqe.user_data, cqe.res};
+      }
+      if (n == 0ull)
+        return drained;
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+      for (size_t i = 0ull; i < n; ++i)
+        f(batch[i].first, batch[i].second);
+      drained += n;
+    }
+  }
+
+  bool registerBuffers(const std::vector<iovec> &buffers) {
+    return ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+                     buffers.data(), unsigned(buffers.size())) == 0;
+  }
+
+  void unregisterBuffers() {
+    ::syscall(__NR_io_uring_register, fd_, IORING_UNREGISTER_BUFFERS, nullptr,
+              0u);
+  }
+
+private:
+  IoUring(int fd, const io_uring_params &params)
+      : fd_{fd}, params_{params} {}
+
+  bool map() {
+    const auto &sq = params_.sq_off;
+    const auto &cq = params_.cq_off;
+    sq_ring_size_ = sq.array + params_.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = cq.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+    if (params_.features & IORING_FEAT_SINGLE_MMAP)
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+    sq_ring_ = mapRing(sq_ring_size_, IORING_OFF_SQ_RING);
+    if (!sq_ring_)
+      return false;
+    cq_ring_ = (params_.features & IORING_FEAT_SINGLE_MMAP)
+                   ? sq_ring_
+                   : mapRing(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(mapRing(sqes_size_, IORING_OFF_SQES));
+    if (!cq_ring_ || !sqes_)
+      return false;
+
+    auto *sq_base = static_cast<uint8_t *>(sq_ring_);
+    auto *cq_base = static_cast<uint8_t *>(cq_ring_);
+    sq_head_ = reinterpret_cast<unsigned *>(sq_base + sq.head);
+    sq_ktail_ = reinterpret_cast<unsigned *>(sq_base + sq.tail);
+    sq_mask_ = reinterpret_cast<unsigned *>(sq_base + sq.ring_mask);
+    sq_entries_ = reinterpret_cast<unsigned *>(sq_base + sq.ring_entries);
+    sq_array_ = reinterpret_cast<unsigned *>(sq_base + sq.array);
+    sq_tail_ = *sq_ktail_;
+    cq_head_ = reinterpret_cast<unsigned *>(cq_base + cq.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq_base + cq.tail);
+    cq_mask_ = reinterpret_cast<unsigned *>(cq_base + cq.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq_base + cq.cqes);
+    return true;
+  }
+
+  void *mapRing(size_t size, off_t offset) const {
+    auto *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_, offset);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+  int enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return int(::syscall(__NR_io_uring_enter, fd_, to_submit, min_complete,
+                         flags, nullptr, 0));
+  }
+
+  const int fd_;
+  const io_uring_params params_;
+  void *sq_ring_ = nullptr;
+  void *cq_ring_ = nullptr;
+  io_uring_sqe *sqes_ = nullptr;
+  size_t sq_ring_size_ = 0ull, cq_ring_size_ = 0ull, sqes_size_ = 0ull;
+  unsigned *sq_head_ = nullptr, *sq_ktail_ = nullptr, *sq_mask_ = nullptr,
+           *sq_entries_ = nullptr, *sq_array_ = nullptr;
+  unsigned sq_tail_ = 0u, to_submit_ = 0u;
+  unsigned *cq_head_ = nullptr, *cq_tail_ = nullptr, *cq_mask_ = nullptr;
+  io_uring_cqe *cqes_ = nullptr;
+};
+
+#endif // EC_CPP_IO_URING
+
+} // namespace detail
+
+/// Persists the shards of candidates to files while they are encoded.
+///
+/// A candidate's `ShardSet` is handed to `begin` with one open file per
+/// shard, then `write` is called as ranges of every shard become final,
+/// typically from the `on_block` stage of `ReedSolomon::encodeInto`, and
+/// `finish` once the encode is done. Ranges are gathered into writes of at
+/// least `kMinWrite` bytes per shard, each shard file being written front
+/// to back, and the future `finish` returns is the one notification of the
+/// candidate: it is ready when all its writes are.
+///
+/// With io_uring the writes are submitted from the calling thread and
+/// completed by a reaper thread; while no other candidate is in flight the
+/// `ShardSet` is registered and written with fixed buffers. Without it,
+/// worker threads take the writes from a queue.
+class ShardWriter final {
+public:
+  /// Bytes of one shard gathered before they are written.
+  static constexpr size_t kMinWrite = 64ull << 10;
+
+  class Candidate final {
+  public:
+    Candidate(const ShardSet &set, std::vector<int> files, size_t file_offset)
+        : set_{set}, files_{std::move(files)}, file_offset_{file_offset} {}
+
+  private:
+    friend class ShardWriter;
+
+    const ShardSet &set_;
+    const std::vector<int> files_;
+    const size_t file_offset_;
+    /// Bytes of each shard final, and handed to the backend.
+    size_t ready_ = 0ull, submitted_ = 0ull;
+    /// Registered buffers of the set, when it is.
+    bool fixed_ = false;
+    size_t pending_ = 0ull;
+    bool finished_ = false, failed_ = false;
+    std::promise<Result<bool>> done_;
+  };
+
+  /// @param backend `kIoUring` falls back to `kThreads` where io_uring is
+  /// not available
+  /// @param threads workers of the `kThreads` backend
+  explicit ShardWriter(WriteBackend backend = WriteBackend::kIoUring,
+                       size_t threads = 2ull) {
+#if EC_CPP_IO_URING
+    if (backend == WriteBackend::kIoUring) {
+      ring_ = detail::IoUring::create(kRingEntries);
+      if (ring_) {
+        reaper_ = std::thread([this] { reapLoop(); });
+        return;
+      }
+    }
+#endif
+    for (size_t t = 0ull; t < std::max(threads, size_t(1ull)); ++t)
+      workers_.emplace_back([this] { workLoop(); });
+  }
+
+  ShardWriter(const ShardWriter &) = delete;
+  ShardWriter &operator=(const ShardWriter &) = delete;
+
+  /// Waits for the writes in flight.
+  ~ShardWriter() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&] { return in_flight_ == 0ull; });
+    stop_ = true;
+#if EC_CPP_IO_URING
+    if (ring_) {
+      // a no-op with no candidate wakes the reaper at once; should the ring
+      // refuse it, the reaper sees `stop_` when its wait times out
+      if (!reaper_done_) {
+        io_uring_sqe *sqe;
+        while (!(sqe = ring_->sqe()))
+          submitQueued();
+        sqe->opcode = IORING_OP_NOP;
+        submitQueued();
+      }
+      lock.unlock();
+      reaper_.join();
+      if (registered_)
+        ring_->unregisterBuffers();
+      return;
+    }
+#endif
+    lock.unlock();
+    queued_.notify_all();
+    for (auto &worker : workers_)
+      worker.join();
+  }
+
+  WriteBackend backend() const {
+#if EC_CPP_IO_URING
+    if (ring_)
+      return WriteBackend::kIoUring;
+#endif
+    return WriteBackend::kThreads;
+  }
+
+  /// Starts persisting `set`, shard `i` to `files[i]` from `file_offset` on.
+  /// `set` and the files must stay valid until the candidate completes.
+  std::shared_ptr<Candidate> begin(const ShardSet &set, std::vector<int> files,
+                                   size_t file_offset = 0ull) {
+    assert(files.size() >= set.count());
+    auto candidate =
+        std::make_shared<Candidate>(set, std::move(files), file_offset);
+#if EC_CPP_IO_URING
+    std::lock_guard lock(mutex_);
+    if (ring_) {
+      if (live_ == 0ull) {
+        if (registered_)
+          ring_->unregisterBuffers();
+        registered_ = ring_->registerBuffers(registration(set));
+        candidate->fixed_ = registered_;
+      }
+      ++live_;
+    }
+#endif
+    return candidate;
+  }
+
+  /// Bytes `[first, last)` of every shard are final. Ranges come in order.
+  void write(const std::shared_ptr<Candidate> &candidate, size_t first,
+             size_t last) {
+    std::unique_lock lock(mutex_);
+    assert(first == candidate->ready_ && last >= first);
+    candidate->ready_ = last;
+    if (candidate->ready_ - candidate->submitted_ >= kMinWrite)
+      flush(lock, candidate);
+  }
+
+  /// No more ranges come for `candidate`. Its writes having been handed
+  /// over, the future is ready once they all complete.
+  /// @return `kIoError` if some write failed
+  std::future<Result<bool>>
+  finish(const std::shared_ptr<Candidate> &candidate) {
+    std::unique_lock lock(mutex_);
+    flush(lock, candidate);
+    candidate->finished_ = true;
+    auto done = candidate->done_.get_future();
+    settle(*candidate);
+    return done;
+  }
+
+private:
+  static constexpr unsigned kRingEntries = 256u;
+  /// Longest the reaper waits before it looks at `stop_`.
+  static constexpr int64_t kReapTimeoutNs = 100'000'000;
+  /// Largest buffer the kernel registers.
+  static constexpr size_t kMaxRegistered = 1ull << 30;
+
+  /// One write of a shard range, owned by the backend until it completes.
+  struct Write {
+    std::shared_ptr<Candidate> candidate;
+    int fd;
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+  };
+
+  static std::vector<iovec> registration(const ShardSet &set) {
+    std::vector<iovec> buffers;
+    for (size_t b = 0ull; b < set.size(); b += kMaxRegistered)
+      buffers.push_back({const_cast<uint8_t *>(set.data()) + b,
+                         std::min(kMaxRegistered, set.size() - b)});
+    return buffers;
+  }
+
+  /// Hands the ready part of every shard to the backend, letting go of
+  /// `lock` between shards so that completions are not held up meanwhile.
+  void flush(std::unique_lock<std::mutex> &lock,
+             const std::shared_ptr<Candidate> &candidate) {
+    auto &c = *candidate;
+    if (c.ready_ == c.submitted_)
+      return;
+    const auto first = c.submitted_, size = c.ready_ - c.submitted_;
+    c.submitted_ = c.ready_;
+    const auto &set = c.set_;
+    for (size_t i = 0ull; i < set.count(); ++i) {
+      if (i != 0ull) {
+        lock.unlock();
+        lock.lock();
+      }
+      const auto *data = set.data() + i * set.shardLen();
+      submit(Write{candidate, c.files_[i], data + first, size,
+                   c.file_offset_ + first});
+    }
+#if EC_CPP_IO_URING
+    if (ring_)
+      submitQueued();
+#endif
+  }
+
+  void submit(Write write) {
+    ++write.candidate->pending_;
+    ++in_flight_;
+#if EC_CPP_IO_URING
+    if (ring_) {
+      // a fixed write stays inside one registered buffer
+      const auto *base = write.candidate->set_.data();
+      const auto start = size_t(write.data - base);
+      const auto end = start + write.size - 1ull;
+      if (write.candidate->fixed_ &&
+          start / kMaxRegistered != end / kMaxRegistered) {
+        const auto head = kMaxRegistered - start % kMaxRegistered;
+        auto tail = write;
+        tail.data += head;
+        tail.size -= head;
+        tail.offset += head;
+        write.size = head;
+        submit(std::move(tail));
+      }
+      submitRing(new Write(std::move(write)));
+      return;
+    }
+#endif
+    jobs_.push_back(std::move(write));
+    queued_.notify_one();
+  }
+
+#if EC_CPP_IO_URING
+  /// Queues `write` on the ring, to go with the next `submitQueued`.
+  void submitRing(Write *write) {
+    if (reaper_done_) {
+      complete(write, false);
+      return;
+    }
+    io_uring_sqe *sqe;
+    while (!(sqe = ring_->sqe()))
+      submitQueued();
+    const auto &c = *write->candidate;
+    sqe->opcode = c.fixed_ ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = write->fd;
+    sqe->addr = uint64_t(uintptr_t(write->data));
+    sqe->len = unsigned(write->size);
+    sqe->off = write->offset;
+    if (c.fixed_)
+      sqe->buf_index = uint16_t(size_t(write->data - c.set_.data()) /
+                                kMaxRegistered);
+    sqe->user_data = uint64_t(uintptr_t(write));
+    ring_writes_.insert(write);
+  }
+
+  /// Hands the queued writes to the kernel. While it is out of room the
+  /// completions are taken here to make some; the writes it refuses for
+  /// any other reason fail, as their candidates could not otherwise settle.
+  void submitQueued() {
+    for (;;) {
+      const auto error = ring_->submit();
+      if (error == 0)
+        return;
+      if (error != EAGAIN && error != EBUSY)
+        break;
+      ring_->poll();
+      if (drain() == 0ull)
+        std::this_thread::yield();
+    }
+    ring_->withdraw([&](uint64_t user_data) {
+      if (user_data != 0u)
+        complete(reinterpret_cast<Write *>(uintptr_t(user_data)), false);
+    });
+  }
+
+  /// Called with `mutex_` held.
+  size_t drain() {
+    return ring_->drain(
+        [&](uint64_t user_data, int res) { onCompletion(user_data, res); });
+  }
+
+  /// Called with `mutex_` held. The no-op of the destructor has no write.
+  void onCompletion(uint64_t user_data, int res) {
+    auto *write = reinterpret_cast<Write *>(uintptr_t(user_data));
+    if (!write)
+      return;
+    if (res > 0 && size_t(res) < write->size) {
+      // a short write goes again for the rest
+      write->data += res;
+      write->size -= size_t(res);
+      write->offset += size_t(res);
+      ring_writes_.erase(write);
+      submitRing(write);
+      submitQueued();
+      return;
+    }
+    complete(write, res >= 0);
+  }
+
+  void reapLoop() {
+    for (;;) {
+      const auto ok = ring_->wait(kReapTimeoutNs);
+      std::lock_guard lock(mutex_);
+      if (!ok) {
+        // no completion arrives any more: the writes the kernel holds fail
+        reaper_done_ = true;
+        const std::vector<Write *> lost(ring_writes_.begin(),
+                                       ring_writes_.end());
+        for (auto *write : lost)
+          complete(write, false);
+        return;
+      }
+      drain();
+      if (stop_)
+        return;
+    }
+  }
+#endif
+
+  void workLoop() {
+    for (;;) {
+      std::unique_lock lock(mutex_);
+      queued_.wait(lock, [&] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty())
+        return;
+      auto write = std::move(jobs_.front());
+      jobs_.pop_front();
+      lock.unlock();
+
+      bool ok = true;
+      while (ok && write.size != 0ull) {
+        iovec iov{const_cast<uint8_t *>(write.data), write.size};
+        const auto written = ::pwritev(write.fd, &iov, 1, off_t(write.offset));
+        if (written < 0 && errno == EINTR)
+          continue;
+        ok = written > 0;
+        if (ok) {
+          write.data += written;
+          write.size -= size_t(written);
+          write.offset += size_t(written);
+        }
+      }
+
+      lock.lock();
+      auto *c = write.candidate.get();
+      c->failed_ = c->failed_ || !ok;
+      --c->pending_;
+      --in_flight_;
+      settle(*c);
+      if (in_flight_ == 0ull)
+        idle_.notify_all();
+    }
+  }
+
+#if EC_CPP_IO_URING
+  /// Called with `mutex_` held.
+  void complete(Write *write, bool ok) {
+    std::unique_ptr<Write> owned{write};
+    ring_writes_.erase(write);
+    auto &c = *write->candidate;
+    c.failed_ = c.failed_ || !ok;
+    --c.pending_;
+    --in_flight_;
+    settle(c);
+    if (in_flight_ == 0ull)
+      idle_.notify_all();
+  }
+#endif
+
+  /// Notifies a finished candidate once its last write completed.
+  void settle(Candidate &c) {
+    if (!c.finished_ || c.pending_ != 0ull)
+      return;
+    c.finished_ = false;
+#if EC_CPP_IO_URING
+    if (ring_)
+      --live_;
+#endif
+    if (c.failed_)
+      c.done_.set_value(Error::kIoError);
+    else
+      c.done_.set_value(true);
+  }
+
+  std::mutex mutex_;
+  std::condition_variable idle_, queued_;
+  size_t in_flight_ = 0ull;
+  bool stop_ = false;
+  std::deque<Write> jobs_;
+  std::vector<std::thread> workers_;
+#if EC_CPP_IO_URING
+  std::unique_ptr<detail::IoUring> ring_;
+  std::thread reaper_;
+  bool registered_ = false;
+  size_t live_ = 0ull;
+  /// Writes queued on the ring or held by the kernel.
+  std::unordered_set<Write *> ring_writes_;
+  /// Set once the reaper stopped on an error.
+  bool reaper_done_ = false;
+#endif
+};
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_SHARD_WRITER_HPP
@@ -0,0 +1,178 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_THREAD_POOL_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+namespace ec_cpp {
+
+/// Fixed set of workers running one data-parallel loop at a time. The
+/// calling thread takes part in the loop. Loops issued from a worker, or
+/// while another loop is in flight, run inline on the caller.
+class ThreadPool final {
+public:
+  explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) {
+    const auto workers = std::max(threads, size_t(1ull)) - 1ull;
+    workers_.reserve(workers);
+    for (size_t i = 0ull; i < workers; ++i)
+      workers_.emplace_back([this] { workerLoop(); });
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &w : workers_)
+      w.join();
+  }
+
+  /// Number of threads taking part in a loop, the caller included.
+  size_t size() const { return workers_.size() + 1ull; }
+
+  /// Calls `f(begin, end)` over a partition of `[0, count)` into ranges of at
+  /// least `grain` items and returns once all of them are done.
+  template <typename F>
+  void parallelFor(size_t count, F &&f, size_t grain = 1ull) {
+    if (count == 0ull)
+      return;
+
+    grain = std::max(grain, size_t(1ull));
+    const auto ranges =
+        std::min((count + grain - 1) / grain, size() * kRangesPerThread);
+    // a loop nested in one this thread runs, here or in a worker, would
+    // wait on itself, and try_lock on a mutex it holds is undefined
+    if (ranges <= 1ull || workers_.empty() || inWorker() || inLoop()) {
+      f(size_t(0ull), count);
+      return;
+    }
+    std::unique_lock submit(submit_mutex_, std::try_to_lock);
+    if (!submit) {
+      f(size_t(0ull), count);
+      return;
+    }
+    inLoop() = true;
+    struct LeaveLoop {
+      ~LeaveLoop() { inLoop() = false; }
+    } leave_loop;
+
+    const auto step = (count + ranges - 1) / ranges;
+    std::function<void(size_t)> task = [&](size_t range) {
+      const auto begin = range * step;
+      const auto end = std::min(count, begin + step);
+      if (begin < end)
+        f(begin, end);
+    };
+
+    {
+      std::lock_guard lock(mutex_);
+      task_ = &task;
+      next_ = 0ull;
+      total_ = ranges;
+      done_ = 0ull;
+      ++generation_;
+    }
+    wake_.notify_all();
+
+    runRanges();
+
+    std::unique_lock lock(mutex_);
+    finished_.wait(lock, [&] { return done_ == total_ && active_ == 0ull; });
+    task_ = nullptr;
+  }
+
+  /// Process-wide pool sized to the hardware concurrency.
+  static ThreadPool &shared() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+private:
+  static constexpr size_t kRangesPerThread = 4ull;
+
+  static bool &inWorker() {
+    thread_local bool flag = false;
+    return flag;
+  }
+
+  /// Set while the thread submits a loop of its own.
+  static bool &inLoop() {
+    thread_local bool flag = false;
+    return flag;
+  }
+
+  void workerLoop() {
+    inWorker() = true;
+    size_t seen = 0ull;
+    for (;;) {
+      {
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_)
+          return;
+        seen = generation_;
+      }
+      runRanges();
+    }
+  }
+
+  void runRanges() {
+    const std::function<void(size_t)> *task;
+    size_t total;
+    {
+      std::lock_guard lock(mutex_);
+      if (task_ == nullptr)
+        return;
+      task = task_;
+      total = total_;
+      ++active_;
+    }
+
+    size_t completed = 0ull;
+    for (;;) {
+      const auto range = next_.fetch_add(1ull);
+      if (range >= total)
+        break;
+      (*task)(range);
+      ++completed;
+    }
+
+    std::lock_guard lock(mutex_);
+    done_ += completed;
+    --active_;
+    if (done_ == total_ && active_ == 0ull)
+      finished_.notify_all();
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex submit_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable finished_;
+  const std::function<void(size_t)> *task_ = nullptr;
+  std::atomic<size_t> next_ = 0ull;
+  size_t total_ = 0ull;
+  size_t done_ = 0ull;
+  size_t active_ = 0ull;
+  size_t generation_ = 0ull;
+  bool stop_ = false;
+};
+
+} // namespace ec_cpp
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_THREAD_POOL_HPP
@@ -0,0 +1,188 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_TRANSPOSE_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_TRANSPOSE_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdlib.h>
+
+#include <ec-cpp/cpu.hpp>
+
+namespace ec_cpp::transpose {
+
+/// Number of columns processed per tile. 32 two-byte symbols fill one cache
+/// line of every destination stream.
+constexpr size_t kTileColumns = 32ull;
+
+namespace detail {
+
+typedef uint16_t U16x8 __attribute__((vector_size(16)));
+typedef uint32_t U32x4 __attribute__((vector_size(16)));
+typedef uint64_t U64x2 __attribute__((vector_size(16)));
+
+/// Transposes eight rows of eight 16-bit symbols in three rounds of
+/// interleaves, at 16, 32 and 64 bits.
+EC_CPP_ALWAYS_INLINE void transpose8x8(U16x8 *r) {
+  U16x8 a[8];
+  for (size_t i = 0ull; i < 8ull; i += 2ull) {
+    a[i / 2ull] = __builtin_shuffle(r[i], r[i + 1ull],
+                                    U16x8{0, 8, 1, 9, 2, 10, 3, 11});
+    a[i / 2ull + 4ull] = __builtin_shuffle(r[i], r[i + 1ull],
+                                           U16x8{4, 12, 5, 13, 6, 14, 7, 15});
+  }
+  U32x4 b[8];
+  for (size_t h = 0ull; h < 8ull; h += 4ull)
+    for (size_t i = 0ull; i < 4ull; i += 2ull) {
+      const auto x = (U32x4)a[h + i], y = (U32x4)a[h + i + 1ull];
+      b[h + i / 2ull] = __builtin_shuffle(x, y, U32x4{0, 4, 1, 5});
+      b[h + i / 2ull + 2ull] = __builtin_shuffle(x, y, U32x4{2, 6, 3, 7});
+    }
+  for (size_t i = 0ull; i < 8ull; i += 2ull) {
+    const auto x = (U64x2)b[i], y = (U64x2)b[i + 1ull];
+    r[i] = (U16x8)__builtin_shuffle(x, y, U64x2{0, 2});
+    r[i + 1ull] = (U16x8)__builtin_shuffle(x, y, U64x2{1, 3});
+  }
+}
+
+template <bool Swap> EC_CPP_ALWAYS_INLINE uint16_t load16(const uint8_t *p) {
+  uint16_t x;
+  memcpy(&x, p, 2ull);
+  return Swap ? uint16_t((x << 8u) | (x >> 8u)) : x;
+}
+
+} // namespace detail
+
+/// Transposes 16-bit symbols between two sets of streams: symbol `j` of
+/// source stream `i` becomes symbol `i` of destination stream `j`, for
+/// `i < sources` and `j < length`. `src(i, j)` and `dst(j, i)` give the
+/// address of a symbol; symbols that follow in a stream must follow in
+/// memory, 8 at a time. With `Swap` the two bytes of every symbol are
+/// exchanged on the way, which turns big-endian symbols to native ones on a
+/// little-endian host and back.
+///
+/// Blocks of 8 by 8 symbols are moved through registers, so every stream is
+/// read and written 16 bytes at a time. Callers keep `sources` to a tile so
+/// the destination lines stay in cache between blocks.
+template <bool Swap, typename Src, typename Dst>
+void transpose16(const Src &src, size_t sources, const Dst &dst,
+                 size_t length) {
+  using detail::U16x8;
+  const auto full_i = sources / 8ull * 8ull;
+  const auto full_j = length / 8ull * 8ull;
+
+  for (size_t j0 = 0ull; j0 < full_j; j0 += 8ull)
+    for (size_t i0 = 0ull; i0 < full_i; i0 += 8ull) {
+      U16x8 r[8];
+      for (size_t i = 0ull; i < 8ull; ++i)
+        memcpy(&r[i], src(i0 + i, j0), sizeof(U16x8));
+      detail::transpose8x8(r);
+      for (size_t j = 0ull; j < 8ull; ++j) {
+        if constexpr (Swap)
+          r[j] = (r[j] << 8u) | (r[j] >> 8u);
+        memcpy(dst(j0 + j, i0), &r[j], sizeof(U16x8));
+      }
+    }
+
+  auto scalar = [&](size_t i0, size_t i1, size_t j0, size_t j1) {
+    for (size_t j = j0; j < j1; ++j)
+      for (size_t i = i0; i < i1; ++i) {
+        const auto x = detail::load16<Swap>(src(i, j));
+        memcpy(dst(j, i), &x, 2ull);
+      }
+  };
+  scalar(full_i, sources, 0ull, full_j);
+  scalar(0ull, sources, full_j, length);
+}
+
+/// `transpose16` for symbols of `Bytes` bytes, one or two. Single bytes
+/// have no order to swap and are moved one at a time.
+template <size_t Bytes, bool Swap, typename Src, typename Dst>
+void transposeSymbols(const Src &src, size_t sources, const Dst &dst,
+                      size_t length) {
+  static_assert(Bytes == 1ull || Bytes == 2ull);
+  if constexpr (Bytes == 2ull) {
+    transpose16<Swap>(src, sources, dst, length);
+  } else {
+    for (size_t j = 0ull; j < length; ++j)
+      for (size_t i = 0ull; i < sources; ++i)
+        *dst(j, i) = *src(i, j);
+  }
+}
+
+/// Whether big-endian symbols have to be byte swapped to native ones.
+constexpr bool kSwapBE = std::endian::native == std::endian::little;
+
+/// Copies `count` 16-bit symbols, with `Swap` exchanging the two bytes of
+/// each. `dst` may be `src`.
+template <bool Swap> void copy16(void *dst, const void *src, size_t count) {
+  using detail::U16x8;
+  auto *d = static_cast<uint8_t *>(dst);
+  const auto *s = static_cast<const uint8_t *>(src);
+  if constexpr (!Swap) {
+    if (d != s)
+      memcpy(d, s, count * 2ull);
+    return;
+  }
+  size_t i = 0ull;
+  for (; i + 8ull <= count; i += 8ull) {
+    U16x8 x;
+    memcpy(&x, s + i * 2ull, sizeof(x));
+    x = (x << 8u) | (x >> 8u);
+    memcpy(d + i * 2ull, &x, sizeof(x));
+  }
+  for (; i < count; ++i) {
+    const auto x = detail::load16<true>(s + i * 2ull);
+    memcpy(d + i * 2ull, &x, 2ull);
+  }
+}
+
+/// `copy16` for symbols of `Bytes` bytes, one or two.
+template <size_t Bytes, bool Swap>
+void copySymbols(void *dst, const void *src, size_t count) {
+  static_assert(Bytes == 1ull || Bytes == 2ull);
+  if constexpr (Bytes == 2ull)
+    copy16<Swap>(dst, src, count);
+  else if (dst != src)
+    memcpy(dst, src, count);
+}
+
+/// Copies `count` 16-bit symbols between big-endian and native order, in
+/// either direction.
+inline void convertBE16(void *dst, const void *src, size_t count) {
+  copy16<kSwapBE>(dst, src, count);
+}
+
+/// Copies symbols of `Bytes` bytes `first_row..first_row + rows` of
+/// `columns` consecutive columns of `stride` symbols each from `src` into
+/// the streams `dst[0..rows)`. Bytes are moved as is, so the symbol byte
+/// order is kept, unless `Swap`.
+template <size_t Bytes, bool Swap = false>
+void deinterleaveSymbols(const uint8_t *src, size_t stride, size_t columns,
+                         size_t first_row, size_t rows, uint8_t *const *dst) {
+  const auto stride_bytes = stride * Bytes;
+  for (size_t c0 = 0ull; c0 < columns; c0 += kTileColumns) {
+    const auto c1 = std::min(columns, c0 + kTileColumns);
+    const auto *tile = src + c0 * stride_bytes + first_row * Bytes;
+    transposeSymbols<Bytes, Swap>(
+        [&](size_t c, size_t r) { return tile + c * stride_bytes + r * Bytes; },
+        c1 - c0,
+        [&](size_t r, size_t c) { return dst[r] + (c0 + c) * Bytes; }, rows);
+  }
+}
+
+/// `deinterleaveSymbols` of 16-bit symbols.
+template <bool Swap = false>
+void deinterleave16(const uint8_t *src, size_t stride, size_t columns,
+                    size_t first_row, size_t rows, uint8_t *const *dst) {
+  deinterleaveSymbols<2ull, Swap>(src, stride, columns, first_row, rows, dst);
+}
+
+} // namespace ec_cpp::transpose
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_TRANSPOSE_HPP
@@ -12,6 +12,29 @@ namespace ec_cpp {
 
 template <typename T>
     using Slice = std::span<std::remove_reference_t<T>>;
+
+/// Byte order of the symbols held in shards.
+enum class ShardFormat {
+  /// Big-endian symbols, the canonical wire format.
+  kBigEndian,
+  /// Symbols in the byte order of the host, for shards that never leave
+  /// local storage. The transforms load and store them without swapping.
+  kNative,
+};
+
+/// Codeword layout of `ReedSolomon`, which fixes the parity shards and the
+/// shard length. Nothing in a shard tells the version apart, so encoder and
+/// decoder must agree on it as they agree on `n`.
+enum class CodeVersion {
+  /// `k` rounded down to a power of two holds the payload and is the
+  /// transform block. Shards are up to twice as long as `payload / k`.
+  kV1 = 1,
+  /// Exactly `k` shards hold the payload, in a transform block of `k`
+  /// rounded up to a power of two. The block positions past `k` are zero
+  /// and never sent; the parity shards follow them. Shards are
+  /// `payload / k` long.
+  kV2 = 2,
+};
 }
 
 #endif // NOVELPOLY_REED_SOLOMON_CRUST_TYPES_HPP
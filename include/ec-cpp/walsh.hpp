@@ -8,13 +8,20 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <stdlib.h>
+#include <type_traits>
+#include <utility>
+
+#include <ec-cpp/cpu.hpp>
 
 namespace ec_cpp {
 
+/// Layer by layer Walsh transform of logs, sums taken modulo `kOneMask`
+/// with an end-around carry. Reference for the vector kernels below.
 template <typename TDescriptor>
-constexpr void walsh(std::array<typename TDescriptor::Multiplier,
-                                TDescriptor::kFieldSize> &data) {
+constexpr void walshScalar(std::array<typename TDescriptor::Multiplier,
+                                      TDescriptor::kFieldSize> &data) {
   const auto size = data.size();
   size_t depart_no = 1ull;
 
@@ -38,6 +45,116 @@ constexpr void walsh(std::array<typename TDescriptor::Multiplier,
   }
 }
 
+namespace detail {
+
+typedef uint16_t U16x16 __attribute__((vector_size(32)));
+typedef uint16_t U16x32 __attribute__((vector_size(64)));
+
+/// Layers below this size are run block by block, a block staying in L1.
+constexpr size_t kWalshBlock = 4096ull;
+
+/// The scalar butterfly on 16-bit lanes. `a + b` folded once is the 16-bit
+/// sum plus its carry, and `a + 0xffff - b` is `a + ~b`, so each output is
+/// an add, a compare and a subtract of the all-ones compare mask.
+template <typename V>
+EC_CPP_ALWAYS_INLINE void walshButterfly(V &lo, V &hi) {
+  const V a = lo;
+  const V sum = a + hi;
+  const V difference = a + ~hi;
+  lo = sum - (V)(sum < a);
+  hi = difference - (V)(difference < a);
+}
+
+/// Layer `D` for `D` below the lane count: the partner of lane `t` is lane
+/// `t ^ D` of the same vector.
+template <typename V, size_t D, size_t... Is>
+EC_CPP_ALWAYS_INLINE void walshInnerLayer(uint16_t *data, size_t size,
+                                          std::index_sequence<Is...>) {
+  constexpr auto kLanes = sizeof...(Is);
+  constexpr V partner{uint16_t(Is ^ D)...};
+  constexpr V low{uint16_t((Is & D) != 0ull ? 0u : 0xffffu)...};
+  for (size_t i = 0ull; i < size; i += kLanes) {
+    V x, y;
+    memcpy(&x, data + i, sizeof(V));
+    y = __builtin_shuffle(x, partner);
+    V lo = (x & low) | (y & ~low);
+    V hi = (y & low) | (~x & ~low);
+    const V sum = lo + hi;
+    lo = sum - (V)(sum < lo);
+    memcpy(data + i, &lo, sizeof(V));
+  }
+}
+
+template <typename V>
+EC_CPP_ALWAYS_INLINE void walshOuterLayer(uint16_t *data, size_t size,
+                                          size_t d) {
+  constexpr auto kLanes = sizeof(V) / sizeof(uint16_t);
+  for (size_t j = 0ull; j < size; j += (d << 1ull))
+    for (size_t i = j; i < j + d; i += kLanes) {
+      V lo, hi;
+      memcpy(&lo, data + i, sizeof(V));
+      memcpy(&hi, data + i + d, sizeof(V));
+      walshButterfly(lo, hi);
+      memcpy(data + i, &lo, sizeof(V));
+      memcpy(data + i + d, &hi, sizeof(V));
+    }
+}
+
+template <typename V, size_t D = 1ull>
+EC_CPP_ALWAYS_INLINE void walshInnerLayers(uint16_t *data, size_t size) {
+  constexpr auto kLanes = sizeof(V) / sizeof(uint16_t);
+  if constexpr (D < kLanes) {
+    walshInnerLayer<V, D>(data, size, std::make_index_sequence<kLanes>{});
+    walshInnerLayers<V, (D << 1ull)>(data, size);
+  }
+}
+
+/// `size` is a power of two, at least `kWalshBlock`.
+template <typename V>
+EC_CPP_ALWAYS_INLINE void walshKernel(uint16_t *data, size_t size) {
+  constexpr auto kLanes = sizeof(V) / sizeof(uint16_t);
+  for (size_t b = 0ull; b < size; b += kWalshBlock) {
+    walshInnerLayers<V>(data + b, kWalshBlock);
+    for (size_t d = kLanes; d < kWalshBlock; d = (d << 1ull))
+      walshOuterLayer<V>(data + b, kWalshBlock, d);
+  }
+  for (size_t d = kWalshBlock; d < size; d = (d << 1ull))
+    walshOuterLayer<V>(data, size, d);
+}
+
+EC_CPP_TARGET("avx2")
+inline void walshAvx2(uint16_t *data, size_t size) {
+  walshKernel<U16x16>(data, size);
+}
+
+EC_CPP_TARGET("avx512bw")
+inline void walshAvx512(uint16_t *data, size_t size) {
+  walshKernel<U16x32>(data, size);
+}
+
+} // namespace detail
+
+/// Walsh transform of logs in place. Fields of 16-bit logs take the widest
+/// vector kernel the CPU supports; the output is the one of `walshScalar`
+/// bit for bit.
+template <typename TDescriptor>
+constexpr void walsh(std::array<typename TDescriptor::Multiplier,
+                                TDescriptor::kFieldSize> &data) {
+#if EC_CPP_X86_64
+  if constexpr (std::is_same_v<typename TDescriptor::Multiplier, uint16_t> &&
+                TDescriptor::kFieldBits == 16ull &&
+                TDescriptor::kFieldSize >= detail::kWalshBlock) {
+    if (!std::is_constant_evaluated()) {
+      if (cpu::hasAvx512bw())
+        return detail::walshAvx512(data.data(), data.size());
+      if (cpu::hasAvx2())
+        return detail::walshAvx2(data.data(), data.size());
+    }
+  }
+#endif
+  walshScalar<TDescriptor>(data);
+}
+
 } // namespace ec_cpp
 
 #endif // NOVELPOLY_REED_SOLOMON_CRUST_WALSH_HPP
@@ -0,0 +1,62 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <ec-cpp/ec-cpp.hpp>
+
+#include "test_util.hpp"
+
+TEST(erasure_coding, Cpp_BitslicedPackUnpack) {
+  uint16_t symbols[ec_cpp::bitsliced::kLanes];
+  for (size_t t = 0; t < ec_cpp::bitsliced::kLanes; ++t)
+    symbols[t] = uint16_t(t * 40503 + 1);
+
+  ec_cpp::bitsliced::Word w;
+  ec_cpp::bitsliced::pack(symbols, w);
+  for (size_t b = 0; b < 16; ++b)
+    for (size_t t = 0; t < ec_cpp::bitsliced::kLanes; ++t)
+      ASSERT_EQ((w.plane[b] >> t) & 1, (symbols[t] >> b) & 1u);
+
+  uint16_t back[ec_cpp::bitsliced::kLanes];
+  ec_cpp::bitsliced::unpack(w, back);
+  ASSERT_TRUE(std::equal(symbols, symbols + ec_cpp::bitsliced::kLanes, back));
+}
+
+TEST(erasure_coding, Cpp_BitslicedEncode) {
+  for (size_t n : {2ull, 6ull, 100ull, 1000ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+    auto bitsliced = encoder;
+    bitsliced.selectEngine(ec_cpp::TransformEngine::kBitsliced);
+    ASSERT_EQ(bitsliced.engine(), ec_cpp::TransformEngine::kBitsliced);
+
+    for (size_t size : {1ull, 301ull, 70001ull}) {
+      auto payload = ec_cpp::test::makePayload(size);
+      auto expected = ec_cpp::resultGetValue(
+          encoder.encode({payload.data(), payload.size()}));
+      auto shards = ec_cpp::resultGetValue(
+          bitsliced.encode({payload.data(), payload.size()}));
+      ASSERT_EQ(shards, expected) << "n = " << n << ", size = " << size;
+    }
+  }
+}
+
+TEST(erasure_coding, Cpp_BitslicedReconstruct) {
+  for (size_t n : {4ull, 100ull, 1000ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+    encoder.selectEngine(ec_cpp::TransformEngine::kBitsliced);
+    auto payload = ec_cpp::test::makePayload(70001);
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+    for (size_t i = 0; i < n; i += 3)
+      shards[i].clear();
+
+    auto result = encoder.reconstruct(shards);
+    ASSERT_FALSE(ec_cpp::resultHasError(result)) << "n = " << n;
+    auto data = ec_cpp::resultGetValue(std::move(result));
+    data.resize(payload.size());
+    ASSERT_EQ(data, payload) << "n = " << n;
+  }
+}
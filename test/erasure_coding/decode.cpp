@@ -0,0 +1,355 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <ec-cpp/ec-cpp.hpp>
+
+#include "test_util.hpp"
+
+TEST(erasure_coding, Cpp_ReconstructCorrecting) {
+  for (size_t n : {4ull, 10ull, 100ull, 1000ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+    auto payload = ec_cpp::test::makePayload(5003);
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+
+    // drop a few shards and silently corrupt some of the rest, up to what
+    // the redundancy left can locate
+    std::vector<size_t> dropped = {1, n - 1};
+    for (auto i : dropped)
+      shards[i].clear();
+    const auto received = n - dropped.size();
+    const auto t = (received - encoder.k()) / 2;
+
+    std::vector<size_t> corrupted;
+    for (size_t i = 0; i < n && corrupted.size() < t; i += 3) {
+      if (shards[i].empty())
+        continue;
+      shards[i][(i * 7) % shards[i].size()] ^= 0x5a;
+      corrupted.push_back(i);
+    }
+
+    auto result = encoder.reconstructCorrecting(shards);
+    ASSERT_FALSE(ec_cpp::resultHasError(result)) << "n = " << n;
+    auto corrected = ec_cpp::resultGetValue(std::move(result));
+    ASSERT_EQ(corrected.corrupted, corrupted);
+    corrected.data.resize(payload.size());
+    ASSERT_EQ(corrected.data, payload);
+  }
+}
+
+TEST(erasure_coding, Cpp_ReconstructCorrectingTooManyErrors) {
+  const size_t n = 10;
+  auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+  auto payload = ec_cpp::test::makePayload(1001);
+  auto shards = ec_cpp::resultGetValue(
+      encoder.encode({payload.data(), payload.size()}));
+
+  // 10 shards with k = 4 locate at most 3 corrupted ones
+  for (size_t i : {0, 2, 5, 7})
+    shards[i][0] ^= 1;
+  ASSERT_EQ(ec_cpp::resultGetError(encoder.reconstructCorrecting(shards)),
+            ec_cpp::Error::kTooManyCorruptedShards);
+
+  // with exactly k shards nothing can be checked
+  shards.assign(n, {});
+  auto clean = ec_cpp::resultGetValue(
+      encoder.encode({payload.data(), payload.size()}));
+  for (size_t i = 0; i < encoder.k(); ++i)
+    shards[i] = clean[i];
+  auto result = encoder.reconstructCorrecting(shards);
+  ASSERT_FALSE(ec_cpp::resultHasError(result));
+  ASSERT_TRUE(ec_cpp::resultGetValue(std::move(result)).corrupted.empty());
+}
+
+TEST(erasure_coding, Cpp_ReconstructWithSubset) {
+  const size_t n = 100;
+  auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+  const auto k = encoder.k();
+  auto payload = ec_cpp::test::makePayload(20011);
+  auto shards = ec_cpp::resultGetValue(
+      encoder.encode({payload.data(), payload.size()}));
+
+  auto check = [&](const std::vector<std::vector<uint8_t>> &received,
+                   const std::vector<size_t> &expected_subset) {
+    auto result = encoder.reconstructWithSubset(received);
+    ASSERT_FALSE(ec_cpp::resultHasError(result));
+    auto decoded = ec_cpp::resultGetValue(std::move(result));
+    ASSERT_EQ(decoded.subset, expected_subset);
+    decoded.data.resize(payload.size());
+    ASSERT_EQ(decoded.data, payload);
+  };
+
+  // every systematic shard present: no decode at all
+  std::vector<size_t> systematic(k);
+  for (size_t i = 0; i < k; ++i)
+    systematic[i] = i;
+  check(shards, systematic);
+
+  // two systematic shards missing: the lowest parity shards fill in
+  auto received = shards;
+  received[3].clear();
+  received[7].clear();
+  std::vector<size_t> subset;
+  for (size_t i = 0; subset.size() < k; ++i)
+    if (i != 3 && i != 7)
+      subset.push_back(i);
+  check(received, subset);
+
+  // only the tail of the codeword left
+  received.assign(n, {});
+  subset.clear();
+  for (size_t i = n - k; i < n; ++i) {
+    received[i] = shards[i];
+    subset.push_back(i);
+  }
+  check(received, subset);
+}
+
+TEST(erasure_coding, Cpp_AvailabilitySession) {
+  for (size_t n : {2ull, 10ull, 100ull, 1000ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+    const auto k = encoder.k();
+    auto payload = ec_cpp::test::makePayload(7777);
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+
+    // chunks arrive in a scattered order, systematic ones among them
+    std::vector<size_t> order;
+    for (size_t i = 0; i < n; ++i)
+      order.push_back((i * 7 + n / 2) % n);
+    std::sort(order.begin(), order.end());
+    order.erase(std::unique(order.begin(), order.end()), order.end());
+    std::reverse(order.begin(), order.end());
+    ASSERT_GE(order.size(), k);
+
+    auto session =
+        ec_cpp::resultGetValue(ec_cpp::createAvailabilitySession(n));
+    for (size_t j = 0; j < k; ++j) {
+      const auto &chunk = shards[order[j]];
+      auto added = session.addChunk(order[j], chunk);
+      ASSERT_FALSE(ec_cpp::resultHasError(added));
+      ASSERT_EQ(ec_cpp::resultGetValue(std::move(added)), j + 1 == k);
+    }
+    ASSERT_TRUE(session.complete());
+    auto data = session.data();
+    data.resize(payload.size());
+    ASSERT_EQ(data, payload) << "n = " << n;
+
+    // the systematic fast path
+    auto systematic =
+        ec_cpp::resultGetValue(ec_cpp::createAvailabilitySession(n));
+    for (size_t i = k; i-- > 0;)
+      ASSERT_FALSE(
+          ec_cpp::resultHasError(systematic.addChunk(i, shards[i])));
+    data = systematic.data();
+    data.resize(payload.size());
+    ASSERT_EQ(data, payload);
+  }
+}
+
+TEST(erasure_coding, Cpp_AvailabilitySessionRejects) {
+  auto session = ec_cpp::resultGetValue(ec_cpp::createAvailabilitySession(10));
+  std::vector<uint8_t> chunk(8, 1);
+  std::vector<uint8_t> other(10, 1);
+
+  ASSERT_FALSE(ec_cpp::resultHasError(session.addChunk(5, chunk)));
+  ASSERT_EQ(ec_cpp::resultGetError(session.addChunk(5, chunk)),
+            ec_cpp::Error::kDuplicateChunk);
+  ASSERT_EQ(ec_cpp::resultGetError(session.addChunk(6, other)),
+            ec_cpp::Error::kInconsistentShardLengths);
+  ASSERT_EQ(ec_cpp::resultGetError(session.addChunk(10, chunk)),
+            ec_cpp::Error::kChunkIndexOutOfRange);
+  ASSERT_EQ(ec_cpp::resultGetError(session.addChunk(7, {})),
+            ec_cpp::Error::kEmptyShard);
+  ASSERT_EQ(session.received(), 1);
+  ASSERT_FALSE(session.complete());
+}
+
+TEST(erasure_coding, Cpp_ReconstructBatch) {
+  const size_t n = 100;
+  auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+
+  std::vector<std::vector<uint8_t>> payloads;
+  std::vector<std::vector<std::vector<uint8_t>>> batch;
+  for (size_t size : {1ull, 1000ull, 50001ull, 123456ull}) {
+    payloads.push_back(ec_cpp::test::makePayload(size));
+    auto shards = ec_cpp::resultGetValue(encoder.encode(
+        {payloads.back().data(), payloads.back().size()}));
+    for (size_t i = 0; i < n; i += 2)
+      shards[i].clear();
+    batch.push_back(std::move(shards));
+  }
+  // a shard missing from one payload only is left out for all of them
+  batch[2][1].clear();
+
+  ec_cpp::ThreadPool pool(4);
+  auto result = encoder.reconstructBatch(batch, pool);
+  ASSERT_FALSE(ec_cpp::resultHasError(result));
+  auto decoded = ec_cpp::resultGetValue(std::move(result));
+  ASSERT_EQ(decoded.size(), batch.size());
+  for (size_t p = 0; p < batch.size(); ++p) {
+    ASSERT_EQ(decoded[p],
+              ec_cpp::resultGetValue(encoder.reconstruct(batch[p])));
+    decoded[p].resize(payloads[p].size());
+    ASSERT_EQ(decoded[p], payloads[p]);
+  }
+
+  for (size_t i = 1; i < n; i += 4)
+    batch[3][i].clear();
+  ASSERT_EQ(ec_cpp::resultGetError(encoder.reconstructBatch(batch, pool)),
+            ec_cpp::Error::kNeedMoreShards);
+}
+
+TEST(erasure_coding, Cpp_ReconstructLargeN) {
+  // transforms above AdditiveFFT::kResidentSize take the recursive path
+  for (size_t n : {20000ull, 65000ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+    auto payload = ec_cpp::test::makePayload(100003);
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+    for (size_t i = 0; i < n; i += 3)
+      shards[i].clear();
+
+    auto result = encoder.reconstruct(shards);
+    ASSERT_FALSE(ec_cpp::resultHasError(result)) << "n = " << n;
+    auto data = ec_cpp::resultGetValue(std::move(result));
+    data.resize(payload.size());
+    ASSERT_EQ(data, payload) << "n = " << n;
+  }
+}
+
+TEST(erasure_coding, Cpp_ReconstructFromSystematicInto) {
+  ec_cpp::ThreadPool pool(4);
+  for (const auto format :
+       {ec_cpp::ShardFormat::kBigEndian, ec_cpp::ShardFormat::kNative})
+    for (size_t n : {3ull, 100ull, 1000ull})
+      for (size_t size : {1ull, 777ull, 50001ull, 3000001ull}) {
+        auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+        encoder.selectShardFormat(format);
+        auto payload = ec_cpp::test::makePayload(size);
+        auto shards = ec_cpp::resultGetValue(
+            encoder.encode({payload.data(), payload.size()}));
+        shards.resize(encoder.k());
+
+        auto padded = ec_cpp::resultGetValue(
+            encoder.reconstruct_from_systematic(shards));
+        ASSERT_EQ(padded.size(), shards[0].size() * encoder.k());
+        ASSERT_TRUE(std::equal(payload.begin(), payload.end(), padded.begin()))
+            << "n = " << n << ", size = " << size;
+
+        for (auto *p : {(ec_cpp::ThreadPool *)nullptr, &pool}) {
+          std::vector<uint8_t> out(size + 1, 0xAA);
+          auto result = encoder.reconstructFromSystematicInto(
+              shards, {out.data(), size}, p);
+          ASSERT_FALSE(ec_cpp::resultHasError(result));
+          ASSERT_EQ(out.back(), 0xAA);
+          out.pop_back();
+          ASSERT_EQ(out, payload) << "n = " << n << ", size = " << size;
+        }
+
+        std::vector<uint8_t> too_long(padded.size() + 1);
+        ASSERT_EQ(ec_cpp::resultGetError(encoder.reconstructFromSystematicInto(
+                      shards, {too_long.data(), too_long.size()})),
+                  ec_cpp::Error::kOutputTooLong);
+      }
+}
+
+TEST(erasure_coding, Cpp_CodeVersion2) {
+  using ec_cpp::CodeVersion;
+  for (size_t n : {3ull, 10ull, 16ull, 100ull, 1000ull}) {
+    for (auto engine : {ec_cpp::TransformEngine::kLogExp,
+                        ec_cpp::TransformEngine::kBitsliced}) {
+      auto encoder =
+          ec_cpp::resultGetValue(ec_cpp::create(n, CodeVersion::kV2));
+      encoder.selectEngine(engine);
+      const auto k = ec_cpp::resultGetValue(ec_cpp::getRecoveryThreshold(n));
+      ASSERT_EQ(encoder.k(), k);
+      ASSERT_EQ(encoder.block(), ec_cpp::math::nextHighPowerOf2(k));
+
+      // shards hold exactly the payload over `k`, rounded up to a symbol
+      auto payload = ec_cpp::test::makePayload(50001);
+      auto shards = ec_cpp::resultGetValue(
+          encoder.encode({payload.data(), payload.size()}));
+      ASSERT_EQ(shards.size(), n);
+      ASSERT_EQ(shards[0].size(), (payload.size() / 2 + k) / k * 2);
+      ASSERT_TRUE(ec_cpp::resultGetValue(encoder.verifyCodeword(shards)));
+
+      auto parity = ec_cpp::resultGetValue(
+          encoder.encodeParity({payload.data(), payload.size()}));
+      for (size_t i = 0; i < parity.size(); ++i)
+        ASSERT_EQ(parity[i], shards[k + i]);
+
+      auto systematic = ec_cpp::resultGetValue(
+          encoder.reconstruct_from_systematic(shards));
+      systematic.resize(payload.size());
+      ASSERT_EQ(systematic, payload);
+
+      // any `k` shards recover the payload: the last ones, then a spread
+      for (size_t offset : {n - k, size_t(1)}) {
+        std::vector<ec_cpp::ReedSolomon<ec_cpp::PolyEncoder_f2e16>::Shard>
+            received(n);
+        for (size_t j = 0; j < k; ++j) {
+          const auto i = (offset + j * (n / k)) % n;
+          received[i] = shards[i];
+        }
+        auto result = encoder.reconstructWithSubset(received);
+        ASSERT_FALSE(ec_cpp::resultHasError(result)) << "n = " << n;
+        auto decoded = ec_cpp::resultGetValue(std::move(result));
+        ASSERT_EQ(decoded.subset.size(), k);
+        for (auto i : decoded.subset)
+          ASSERT_FALSE(received[i].empty());
+        decoded.data.resize(payload.size());
+        ASSERT_EQ(decoded.data, payload) << "n = " << n;
+
+        auto batch = ec_cpp::resultGetValue(
+            encoder.reconstructBatch({received, received}));
+        for (auto &data : batch) {
+          data.resize(payload.size());
+          ASSERT_EQ(data, payload);
+        }
+
+        auto session = ec_cpp::resultGetValue(
+            ec_cpp::createAvailabilitySession(n, CodeVersion::kV2));
+        for (size_t i = n; i-- > 0;)
+          if (!received[i].empty()) {
+            ASSERT_FALSE(
+                ec_cpp::resultHasError(session.addChunk(i, received[i])));
+          }
+        ASSERT_TRUE(session.complete());
+        auto data = session.data();
+        data.resize(payload.size());
+        ASSERT_EQ(data, payload);
+      }
+
+      // corrupted shards are located by their shard index
+      if (n >= 10) {
+        auto corrupted = shards;
+        corrupted[1][0] ^= 0x5a;
+        corrupted[n - 1][3] ^= 0x5a;
+        auto corrected = ec_cpp::resultGetValue(
+            encoder.reconstructCorrecting(corrupted));
+        ASSERT_EQ(corrected.corrupted, (std::vector<size_t>{1, n - 1}));
+        corrected.data.resize(payload.size());
+        ASSERT_EQ(corrected.data, payload);
+      }
+    }
+  }
+
+  // `kV1` rounds `k` down, so its shards are longer and its parity differs
+  auto v1 = ec_cpp::resultGetValue(ec_cpp::create(1000));
+  auto v2 = ec_cpp::resultGetValue(ec_cpp::create(1000, CodeVersion::kV2));
+  ASSERT_EQ(v1.k(), 256);
+  ASSERT_EQ(v2.k(), 334);
+  auto payload = ec_cpp::test::makePayload(1 << 20);
+  auto v1_shards = ec_cpp::resultGetValue(
+      v1.encode({payload.data(), payload.size()}));
+  auto v2_shards = ec_cpp::resultGetValue(
+      v2.encode({payload.data(), payload.size()}));
+  ASSERT_EQ(v1_shards[0].size(), 4096);
+  ASSERT_EQ(v2_shards[0].size(), 3140);
+  ASSERT_TRUE(ec_cpp::resultHasError(ec_cpp::create(65536, CodeVersion::kV2)));
+}
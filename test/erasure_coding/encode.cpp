@@ -0,0 +1,252 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <ec-cpp/ec-cpp.hpp>
+
+#include "test_util.hpp"
+
+TEST(erasure_coding, Cpp_EncodeSystematicShards) {
+  for (size_t n : {2ull, 6ull, 100ull, 1000ull}) {
+    for (size_t size : {1ull, 3ull, 301ull, 10007ull}) {
+      auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+      auto payload = ec_cpp::test::makePayload(size);
+
+      auto enc_result = encoder.encode({payload.data(), payload.size()});
+      ASSERT_FALSE(ec_cpp::resultHasError(enc_result));
+      auto shards = ec_cpp::resultGetValue(std::move(enc_result));
+      ASSERT_EQ(shards.size(), n);
+
+      const auto k = encoder.k();
+      for (size_t y = 0; y < k; ++y)
+        for (size_t i = 0; i < shards[y].size(); ++i) {
+          const auto offset = (i / 2) * k * 2 + y * 2 + (i % 2);
+          ASSERT_EQ(shards[y][i], offset < size ? payload[offset] : 0);
+        }
+    }
+  }
+}
+
+TEST(erasure_coding, Cpp_EncodeParity) {
+  for (size_t n : {2ull, 6ull, 100ull, 1000ull}) {
+    for (size_t size : {1ull, 3ull, 301ull, 10007ull}) {
+      auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+      auto payload = ec_cpp::test::makePayload(size);
+
+      auto shards = ec_cpp::resultGetValue(
+          encoder.encode({payload.data(), payload.size()}));
+      auto parity_result = encoder.encodeParity({payload.data(), size});
+      ASSERT_FALSE(ec_cpp::resultHasError(parity_result));
+      auto parity = ec_cpp::resultGetValue(std::move(parity_result));
+
+      ASSERT_EQ(parity.size(), n - encoder.k());
+      for (size_t i = 0; i < parity.size(); ++i)
+        ASSERT_EQ(parity[i], shards[encoder.k() + i]);
+    }
+  }
+}
+
+TEST(erasure_coding, Cpp_EncodeParityEmpty) {
+  auto encoder = ec_cpp::resultGetValue(ec_cpp::create(6));
+  auto result = encoder.encodeParity({});
+  ASSERT_TRUE(ec_cpp::resultHasError(result));
+  ASSERT_EQ(ec_cpp::resultGetError(std::move(result)),
+            ec_cpp::Error::kPayloadSizeIsZero);
+}
+
+TEST(erasure_coding, Cpp_VerifyCodeword) {
+  for (size_t n : {2ull, 6ull, 10ull, 300ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+    auto payload = ec_cpp::test::makePayload(4099);
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+
+    auto result = encoder.verifyCodeword(shards);
+    ASSERT_FALSE(ec_cpp::resultHasError(result));
+    ASSERT_TRUE(ec_cpp::resultGetValue(std::move(result)));
+
+    for (size_t i : {size_t(0), encoder.k(), n - 1}) {
+      auto corrupted = shards;
+      corrupted[i].back() ^= 0x80;
+      result = encoder.verifyCodeword(corrupted);
+      ASSERT_FALSE(ec_cpp::resultHasError(result));
+      ASSERT_FALSE(ec_cpp::resultGetValue(std::move(result)));
+    }
+
+    auto truncated = shards;
+    truncated.back().pop_back();
+    ASSERT_EQ(ec_cpp::resultGetError(encoder.verifyCodeword(truncated)),
+              ec_cpp::Error::kInconsistentShardLengths);
+
+    shards.pop_back();
+    ASSERT_EQ(ec_cpp::resultGetError(encoder.verifyCodeword(shards)),
+              ec_cpp::Error::kNeedMoreShards);
+  }
+}
+
+TEST(erasure_coding, Cpp_Transpose16) {
+  for (size_t sources : {1, 7, 8, 13, 64})
+    for (size_t length : {1, 8, 9, 40}) {
+      const auto src = ec_cpp::test::makePayload(sources * length * 2);
+      std::vector<uint8_t> swapped(src.size()), kept(src.size());
+      ec_cpp::transpose::transpose16<true>(
+          [&](size_t i, size_t j) { return &src[(i * length + j) * 2]; },
+          sources,
+          [&](size_t j, size_t i) { return &swapped[(j * sources + i) * 2]; },
+          length);
+      ec_cpp::transpose::transpose16<false>(
+          [&](size_t i, size_t j) { return &src[(i * length + j) * 2]; },
+          sources,
+          [&](size_t j, size_t i) { return &kept[(j * sources + i) * 2]; },
+          length);
+
+      for (size_t i = 0; i < sources; ++i)
+        for (size_t j = 0; j < length; ++j) {
+          const auto *s = &src[(i * length + j) * 2];
+          ASSERT_EQ(swapped[(j * sources + i) * 2], s[1]);
+          ASSERT_EQ(swapped[(j * sources + i) * 2 + 1], s[0]);
+          ASSERT_EQ(kept[(j * sources + i) * 2], s[0]);
+          ASSERT_EQ(kept[(j * sources + i) * 2 + 1], s[1]);
+        }
+    }
+}
+
+TEST(erasure_coding, Cpp_NativeShardFormat) {
+  using ec_cpp::ShardFormat;
+  auto payload = ec_cpp::test::makePayload(5003);
+  for (const auto engine : {ec_cpp::TransformEngine::kLogExp,
+                            ec_cpp::TransformEngine::kBitsliced})
+    for (size_t n : {3, 10, 100}) {
+      auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+      encoder.selectEngine(engine);
+      const auto wire = ec_cpp::resultGetValue(
+          encoder.encode({payload.data(), payload.size()}));
+      const auto root =
+          ec_cpp::resultGetValue(
+              encoder.encodeWithTrie({payload.data(), payload.size()}))
+              .trie.root();
+
+      encoder.selectShardFormat(ShardFormat::kNative);
+      auto native = ec_cpp::resultGetValue(
+          encoder.encode({payload.data(), payload.size()}));
+      auto converted = native;
+      decltype(encoder)::convertShards(converted, ShardFormat::kNative,
+                                       ShardFormat::kBigEndian);
+      ASSERT_EQ(converted, wire);
+
+      auto chunks = ec_cpp::resultGetValue(
+          encoder.encodeWithTrie({payload.data(), payload.size()}));
+      ASSERT_EQ(chunks.shards, native);
+      ASSERT_EQ(chunks.trie.root(), root);
+      ASSERT_TRUE(ec_cpp::resultGetValue(encoder.verifyCodeword(native)));
+
+      auto systematic = ec_cpp::resultGetValue(
+          encoder.reconstruct_from_systematic(native));
+      systematic.resize(payload.size());
+      ASSERT_EQ(systematic, payload);
+
+      for (size_t i = 0; i < n; i += 2)
+        native[i].clear();
+      auto data = ec_cpp::resultGetValue(encoder.reconstruct(native));
+      data.resize(payload.size());
+      ASSERT_EQ(data, payload);
+    }
+}
+
+TEST(erasure_coding, Cpp_FixedShapeKernels) {
+  using Descriptor = ec_cpp::f2e16_Descriptor;
+  const Descriptor descriptor;
+  const ec_cpp::PolyEncoder_f2e16 poly_enc(descriptor);
+
+  std::apply(
+      [&](auto... shapes) {
+        ([&](auto shape) {
+          constexpr auto n = decltype(shape)::kN;
+          constexpr auto k = decltype(shape)::kK;
+          ASSERT_TRUE(poly_enc.hasFixedKernel(n, k));
+          for (const auto &[first, last] :
+               {std::pair<size_t, size_t>{k, n}, {k + 3ull, n - k - 5ull}}) {
+            std::vector<ec_cpp::Additive<Descriptor>> generic(n), fixed(n);
+            for (size_t i = 0ull; i < k; ++i)
+              generic[i] = fixed[i] = ec_cpp::Additive<Descriptor>{
+                  uint16_t(i * 40503u + first)};
+            poly_enc.encodeParityGeneric(generic.data(), k, first, last);
+            poly_enc.encodeParityFixed<n, k>(fixed.data(), first, last);
+            for (size_t i = 0ull; i < k; ++i)
+              ASSERT_EQ(fixed[i].point_0, generic[i].point_0);
+            for (size_t i = first; i < last; ++i)
+              ASSERT_EQ(fixed[i].point_0, generic[i].point_0);
+          }
+        }(shapes),
+         ...);
+      },
+      ec_cpp::FixedShapes{});
+  ASSERT_FALSE(poly_enc.hasFixedKernel(1024ull, 512ull));
+
+  // n = 300, 500 and 1000 run the fixed kernels in both versions
+  for (const auto version :
+       {ec_cpp::CodeVersion::kV1, ec_cpp::CodeVersion::kV2})
+    for (size_t n : {300ull, 500ull, 1000ull}) {
+      auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n, version));
+      auto payload = ec_cpp::test::makePayload(100003);
+      auto shards = ec_cpp::resultGetValue(
+          encoder.encode({payload.data(), payload.size()}));
+      ASSERT_TRUE(ec_cpp::resultGetValue(encoder.verifyCodeword(shards)));
+      for (size_t i = 0ull; i < n; i += 2ull)
+        shards[i].clear();
+      auto decoded = ec_cpp::resultGetValue(encoder.reconstruct(shards));
+      decoded.resize(payload.size());
+      ASSERT_EQ(decoded, payload);
+    }
+}
+
+TEST(erasure_coding, Cpp_UpdateShards) {
+  constexpr size_t kSize = 10007ull;
+  for (const auto version :
+       {ec_cpp::CodeVersion::kV1, ec_cpp::CodeVersion::kV2})
+    for (const auto format :
+         {ec_cpp::ShardFormat::kBigEndian, ec_cpp::ShardFormat::kNative})
+      for (size_t n : {2ull, 6ull, 100ull, 300ull}) {
+        auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n, version));
+        encoder.selectShardFormat(format);
+        auto payload = ec_cpp::test::makePayload(kSize);
+        auto shards = ec_cpp::resultGetValue(
+            encoder.encode({payload.data(), payload.size()}));
+        // shards not held stay empty
+        shards[n - 1].clear();
+
+        for (const auto &[offset, size] : {std::pair<size_t, size_t>{0, 1},
+                                           {301, 57},
+                                           {1000, 3001},
+                                           {kSize - 5, 5},
+                                           {kSize, 0}}) {
+          std::vector<uint8_t> updated(payload.begin() + offset,
+                                       payload.begin() + offset + size);
+          for (size_t i = 0ull; i < size; ++i)
+            updated[i] = uint8_t(updated[i] * 13 + i);
+          auto result = encoder.updateShards(shards, offset,
+                                             {&payload[offset], size},
+                                             {updated.data(), size});
+          ASSERT_FALSE(ec_cpp::resultHasError(result));
+          std::copy(updated.begin(), updated.end(), payload.begin() + offset);
+
+          auto expected = ec_cpp::resultGetValue(
+              encoder.encode({payload.data(), payload.size()}));
+          expected[n - 1].clear();
+          ASSERT_EQ(shards, expected);
+        }
+
+        const auto capacity = shards[0].size() * encoder.k();
+        uint8_t byte = 0;
+        ASSERT_EQ(ec_cpp::resultGetError(
+                      encoder.updateShards(shards, capacity, {&byte, 1},
+                                           {&byte, 1})),
+                  ec_cpp::Error::kUpdateOutOfRange);
+        ASSERT_EQ(ec_cpp::resultGetError(
+                      encoder.updateShards(shards, 0, {&byte, 1}, {})),
+                  ec_cpp::Error::kUpdateLengthMismatch);
+      }
+}
@@ -0,0 +1,202 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+#include <ec-cpp/blake2b.hpp>
+#include <ec-cpp/ec-cpp.hpp>
+#include <ec-cpp/erasure_root.hpp>
+
+static std::string toHex(const ec_cpp::Hash256 &hash) {
+  static constexpr char kDigits[] = "0123456789abcdef";
+  std::string result;
+  for (auto b : hash) {
+    result += kDigits[b >> 4];
+    result += kDigits[b & 0x0f];
+  }
+  return result;
+}
+
+static std::vector<std::vector<uint8_t>> makeChunks(size_t count) {
+  std::vector<std::vector<uint8_t>> chunks(count);
+  for (size_t i = 0; i < count; ++i)
+    chunks[i].assign(64 + i % 7, uint8_t(i));
+  return chunks;
+}
+
+TEST(erasure_coding, Cpp_Blake2b256) {
+  ASSERT_EQ(toHex(ec_cpp::blake2b_256({})),
+            "0e5751c026e543b2e8ab2eb06099daa1d1e5df47778f7787faab45cdf12fe3a8");
+
+  const uint8_t abc[] = {'a', 'b', 'c'};
+  ASSERT_EQ(toHex(ec_cpp::blake2b_256(abc)),
+            "bddd813c634239723171ef3fee98579b94964e3bb1cb3e427262c8c068d52319");
+
+  std::vector<uint8_t> data(1000);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = uint8_t(i);
+  for (size_t split : {0ull, 1ull, 128ull, 129ull, 999ull}) {
+    ec_cpp::Blake2b hasher;
+    hasher.update(data.data(), split);
+    hasher.update(data.data() + split, data.size() - split);
+    ec_cpp::Hash256 out;
+    hasher.finalize(out.data());
+    ASSERT_EQ(out, ec_cpp::blake2b_256(data));
+  }
+}
+
+TEST(erasure_coding, Cpp_ErasureTrieEmpty) {
+  ec_cpp::ErasureTrie trie{{}};
+  ASSERT_EQ(toHex(trie.root()),
+            "03170a2e7597b7b7e3d84c05391d139a62b157e78786d8c082f29dcf4c111314");
+}
+
+TEST(erasure_coding, Cpp_ErasureTrieBranches) {
+  for (size_t n : {1ull, 2ull, 6ull, 17ull, 300ull, 1000ull}) {
+    const auto chunks = makeChunks(n);
+    const auto trie = ec_cpp::ErasureTrie::fromChunks(chunks);
+
+    for (size_t i = 0; i < n; ++i) {
+      auto proof = ec_cpp::resultGetValue(trie.branch(i));
+      auto hash = ec_cpp::branchHash(trie.root(), proof, i);
+      ASSERT_FALSE(ec_cpp::resultHasError(hash));
+      ASSERT_EQ(ec_cpp::resultGetValue(std::move(hash)),
+                ec_cpp::blake2b_256(chunks[i]));
+    }
+
+    auto out_of_bounds = trie.branch(n);
+    ASSERT_TRUE(ec_cpp::resultHasError(out_of_bounds));
+    ASSERT_EQ(ec_cpp::resultGetError(std::move(out_of_bounds)),
+              ec_cpp::Error::kBranchOutOfBounds);
+  }
+}
+
+TEST(erasure_coding, Cpp_ErasureTrieInvalidProof) {
+  const auto chunks = makeChunks(6);
+  const auto trie = ec_cpp::ErasureTrie::fromChunks(chunks);
+  auto proof = ec_cpp::resultGetValue(trie.branch(3));
+
+  auto tampered = proof;
+  tampered.back().back() ^= 1;
+  auto result = ec_cpp::branchHash(trie.root(), tampered, 3);
+  ASSERT_EQ(ec_cpp::resultGetError(std::move(result)),
+            ec_cpp::Error::kInvalidBranchProof);
+
+  auto missing = proof;
+  missing.pop_back();
+  result = ec_cpp::branchHash(trie.root(), missing, 3);
+  ASSERT_EQ(ec_cpp::resultGetError(std::move(result)),
+            ec_cpp::Error::kInvalidBranchProof);
+
+  result = ec_cpp::branchHash(trie.root(), proof, 6);
+  ASSERT_TRUE(ec_cpp::resultHasError(result));
+}
+
+TEST(erasure_coding, Cpp_EncodeWithTrie) {
+  std::vector<uint8_t> payload(100003);
+  for (size_t i = 0; i < payload.size(); ++i)
+    payload[i] = uint8_t(i * 13);
+
+  ec_cpp::ThreadPool pool(4);
+  for (size_t n : {2ull, 6ull, 300ull}) {
+    auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+    auto shards = ec_cpp::resultGetValue(
+        encoder.encode({payload.data(), payload.size()}));
+
+    auto result =
+        encoder.encodeWithTrie({payload.data(), payload.size()}, pool);
+    ASSERT_FALSE(ec_cpp::resultHasError(result));
+    auto encoded = ec_cpp::resultGetValue(std::move(result));
+
+    ASSERT_EQ(encoded.shards, shards);
+    ASSERT_EQ(encoded.trie.root(),
+              ec_cpp::ErasureTrie::fromChunks(shards).root());
+  }
+}
+
+TEST(erasure_coding, Cpp_NestedParallelFor) {
+  // the ranges the submitting thread runs nest a loop on the same pool
+  ec_cpp::ThreadPool pool(4);
+  std::atomic<size_t> sum{0ull};
+  pool.parallelFor(64ull, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+      pool.parallelFor(100ull, [&](size_t b, size_t e) {
+        for (size_t j = b; j < e; ++j)
+          sum += i * 100ull + j;
+      });
+  });
+  ASSERT_EQ(sum.load(), 6400ull * 6399ull / 2ull);
+}
+
+TEST(erasure_coding, Cpp_ComputeErasureRoot) {
+  for (size_t size : {1ull, 1000ull, 300001ull}) {
+    std::vector<uint8_t> payload(size);
+    for (size_t i = 0; i < payload.size(); ++i)
+      payload[i] = uint8_t(i * 7 + 1);
+
+    for (size_t n : {2ull, 6ull, 300ull, 1000ull}) {
+      auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+      auto shards = ec_cpp::resultGetValue(
+          encoder.encode({payload.data(), payload.size()}));
+
+      auto root = ec_cpp::computeErasureRoot({payload.data(), size}, n);
+      ASSERT_FALSE(ec_cpp::resultHasError(root));
+      ASSERT_EQ(ec_cpp::resultGetValue(std::move(root)),
+                ec_cpp::ErasureTrie::fromChunks(shards).root());
+    }
+  }
+
+  auto empty = ec_cpp::computeErasureRoot({}, 6);
+  ASSERT_EQ(ec_cpp::resultGetError(std::move(empty)),
+            ec_cpp::Error::kPayloadSizeIsZero);
+}
+
+TEST(erasure_coding, Cpp_VerifyBranches) {
+  std::vector<uint8_t> payload(10007);
+  for (size_t i = 0; i < payload.size(); ++i)
+    payload[i] = uint8_t(i * 31 + 5);
+
+  const size_t n = 10;
+  auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n));
+  auto encoded = ec_cpp::resultGetValue(
+      encoder.encodeWithTrie({payload.data(), payload.size()}));
+  const auto root = encoded.trie.root();
+
+  std::vector<ec_cpp::BranchProof> proofs;
+  for (size_t i = 0; i < n; ++i)
+    proofs.push_back(ec_cpp::resultGetValue(encoded.trie.branch(i)));
+
+  auto corrupted = encoded.shards[2];
+  corrupted[0] ^= 1;
+  ec_cpp::Hash256 other_root = root;
+  other_root[0] ^= 1;
+  std::vector<uint8_t> short_chunk(3, 0);
+
+  std::vector<ec_cpp::ChunkBranch> batch;
+  for (size_t i : {0, 1, 4, 5, 7, 9})
+    batch.push_back({encoded.shards[i], i, &proofs[i], &root});
+  batch.push_back({corrupted, 2, &proofs[2], &root});
+  batch.push_back({encoded.shards[3], 6, &proofs[3], &root});
+  batch.push_back({encoded.shards[8], 8, &proofs[8], &other_root});
+  batch.push_back({short_chunk, 3, &proofs[3], &root});
+
+  ec_cpp::ThreadPool pool(4);
+  const auto valid = ec_cpp::verifyBranches(batch, pool);
+  const std::vector<bool> expected = {true,  true,  true,  true, true,
+                                      true,  false, false, false, false};
+  ASSERT_EQ(valid, expected);
+
+  auto shards = ec_cpp::verifiedShards(batch, valid, n);
+  for (size_t i : {2, 3, 6, 8})
+    ASSERT_TRUE(shards[i].empty());
+
+  auto reconstructed = encoder.reconstruct(shards);
+  ASSERT_FALSE(ec_cpp::resultHasError(reconstructed));
+  auto data = ec_cpp::resultGetValue(std::move(reconstructed));
+  data.resize(payload.size());
+  ASSERT_EQ(data, payload);
+}
@@ -0,0 +1,54 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <ec-cpp/ec-cpp.hpp>
+
+#include "test_util.hpp"
+
+TEST(erasure_coding, Cpp_ClmulProduct) {
+  using Table = ec_cpp::Additive<ec_cpp::f2e16_Descriptor>;
+  using Clmul = ec_cpp::f2e16_ClmulDescriptor;
+  const ec_cpp::f2e16_Descriptor descriptor;
+
+  for (uint32_t log : {0u, 1u, 2u, 1000u, 40000u, 65534u, 65535u}) {
+    const auto c = Clmul::constant(uint16_t(log), descriptor.kTables);
+    for (uint32_t x = 0; x < 65536; ++x) {
+      const auto expected =
+          Table{uint16_t(x)}.mul(uint16_t(log), descriptor.kTables).point_0;
+      ASSERT_EQ(Clmul::mulConstant(uint16_t(x), c), expected)
+          << "x = " << x << ", log = " << log;
+      ASSERT_EQ(Clmul::mulPolyGeneric(Clmul::convert(uint16_t(x),
+                                                     Clmul::kToPoly),
+                                       c),
+                Clmul::mulPolyPclmul(Clmul::convert(uint16_t(x),
+                                                    Clmul::kToPoly),
+                                     c));
+    }
+  }
+}
+
+TEST(erasure_coding, Cpp_ClmulEncodeReconstruct) {
+  for (size_t n : {2ull, 6ull, 100ull, 1000ull}) {
+    auto tables = ec_cpp::resultGetValue(ec_cpp::create(n));
+    auto clmul = ec_cpp::resultGetValue(ec_cpp::createClmul(n));
+    auto payload = ec_cpp::test::makePayload(10007);
+
+    auto expected = ec_cpp::resultGetValue(
+        tables.encode({payload.data(), payload.size()}));
+    auto shards = ec_cpp::resultGetValue(
+        clmul.encode({payload.data(), payload.size()}));
+    ASSERT_EQ(shards, expected) << "n = " << n;
+
+    for (size_t i = 0; i < n; i += 3)
+      shards[i].clear();
+    auto result = clmul.reconstruct(shards);
+    ASSERT_FALSE(ec_cpp::resultHasError(result)) << "n = " << n;
+    auto data = ec_cpp::resultGetValue(std::move(result));
+    data.resize(payload.size());
+    ASSERT_EQ(data, payload) << "n = " << n;
+  }
+}
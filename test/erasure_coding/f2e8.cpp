@@ -0,0 +1,112 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <ec-cpp/ec-cpp.hpp>
+
+#include "test_util.hpp"
+
+TEST(erasure_coding, Cpp_F2e8Field) {
+  using Descriptor = ec_cpp::f2e8_Descriptor;
+  using Additive = ec_cpp::Additive<Descriptor>;
+  const Descriptor descriptor;
+  auto mul = [&](uint8_t a, uint8_t b) {
+    if (b == 0)
+      return uint8_t(0);
+    return Additive{a}
+        .mul(Additive{b}.toMultiplier(descriptor.kTables), descriptor.kTables)
+        .point_0;
+  };
+  auto div = [&](uint8_t a, uint8_t b) {
+    const auto log_b = Additive{b}.toMultiplier(descriptor.kTables);
+    return Additive{a}
+        .mul(uint8_t(Descriptor::kOneMask - log_b), descriptor.kTables)
+        .point_0;
+  };
+
+  // logs and exps are inverse bijections on the nonzero elements
+  const auto &[log_table, exp_table, _] = descriptor.kTables;
+  std::vector<bool> seen(256, false);
+  for (size_t x = 1; x < 256; ++x) {
+    ASSERT_LT(log_table[x], Descriptor::kOneMask);
+    ASSERT_FALSE(seen[log_table[x]]);
+    seen[log_table[x]] = true;
+    ASSERT_EQ(exp_table[log_table[x]], x);
+  }
+
+  // the products form a field, symbols being coordinates in a Cantor basis
+  for (uint32_t a = 0; a < 256; ++a)
+    for (uint32_t b = 0; b < 256; ++b) {
+      const auto ab = mul(uint8_t(a), uint8_t(b));
+      ASSERT_EQ(ab, mul(uint8_t(b), uint8_t(a)));
+      if (b != 0) {
+        ASSERT_EQ(div(ab, uint8_t(b)), a);
+      }
+      for (uint32_t c = 0; c < 256; c += 17)
+        ASSERT_EQ(mul(uint8_t(a), uint8_t(b ^ c)),
+                  ab ^ mul(uint8_t(a), uint8_t(c)));
+    }
+  for (size_t i = 1; i < Descriptor::kFieldBits; ++i) {
+    const auto b = uint8_t(1u << i);
+    ASSERT_EQ(mul(b, b) ^ b, uint8_t(1u << (i - 1)));
+  }
+}
+
+TEST(erasure_coding, Cpp_F2e8EncodeReconstruct) {
+  using ec_cpp::CodeVersion;
+  for (auto version : {CodeVersion::kV1, CodeVersion::kV2})
+    for (size_t n : {2ull, 6ull, 100ull, 200ull, 256ull}) {
+      // `kV2` needs `k` rounded up plus `n - k` positions
+      if (version == CodeVersion::kV2 && n >= 200ull) {
+        ASSERT_TRUE(
+            ec_cpp::resultHasError(ec_cpp::createF2e8(n, version)));
+        continue;
+      }
+      auto encoder =
+          ec_cpp::resultGetValue(ec_cpp::createF2e8(n, version));
+      const auto k = encoder.k();
+      auto payload = ec_cpp::test::makePayload(10007);
+
+      auto shards = ec_cpp::resultGetValue(
+          encoder.encode({payload.data(), payload.size()}));
+      ASSERT_EQ(shards.size(), n);
+      ASSERT_EQ(shards[0].size(), (payload.size() + k - 1) / k);
+      ASSERT_TRUE(ec_cpp::resultGetValue(encoder.verifyCodeword(shards)));
+
+      // single byte symbols have no byte order
+      encoder.selectShardFormat(ec_cpp::ShardFormat::kNative);
+      ASSERT_EQ(ec_cpp::resultGetValue(
+                    encoder.encode({payload.data(), payload.size()})),
+                shards);
+
+      auto systematic = ec_cpp::resultGetValue(
+          encoder.reconstruct_from_systematic(shards));
+      systematic.resize(payload.size());
+      ASSERT_EQ(systematic, payload);
+
+      auto received = shards;
+      for (size_t i = 0; i < n; i += 3)
+        received[i].clear();
+      auto result = encoder.reconstruct(received);
+      ASSERT_FALSE(ec_cpp::resultHasError(result)) << "n = " << n;
+      auto data = ec_cpp::resultGetValue(std::move(result));
+      data.resize(payload.size());
+      ASSERT_EQ(data, payload) << "n = " << n;
+
+      if (n >= 100) {
+        auto corrupted = shards;
+        corrupted[2][5] ^= 0x5a;
+        auto corrected = ec_cpp::resultGetValue(
+            encoder.reconstructCorrecting(corrupted));
+        ASSERT_EQ(corrected.corrupted, std::vector<size_t>{2});
+        corrected.data.resize(payload.size());
+        ASSERT_EQ(corrected.data, payload);
+      }
+    }
+
+  ASSERT_EQ(ec_cpp::resultGetError(ec_cpp::createF2e8(257)),
+            ec_cpp::Error::kTooManyValidators);
+}
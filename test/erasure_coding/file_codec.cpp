@@ -0,0 +1,74 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include <ec-cpp/ec-cpp.hpp>
+
+#include "test_util.hpp"
+
+namespace fs = std::filesystem;
+
+TEST(erasure_coding, Cpp_FileCodec) {
+  const auto dir = fs::temp_directory_path() /
+                   ("ec_cpp_file_codec_" + std::to_string(::getpid()));
+  fs::create_directories(dir);
+  auto payload = ec_cpp::test::makePayload(1000003);
+  ec_cpp::test::writeFile(dir / "payload", payload);
+
+  for (const auto version :
+       {ec_cpp::CodeVersion::kV1, ec_cpp::CodeVersion::kV2})
+    for (const auto format :
+         {ec_cpp::ShardFormat::kBigEndian, ec_cpp::ShardFormat::kNative})
+      for (size_t n : {6ull, 100ull}) {
+        auto encoder = ec_cpp::resultGetValue(ec_cpp::create(n, version));
+        encoder.selectShardFormat(format);
+        // a window of a few column groups, for many groups per pass
+        const ec_cpp::FileCodec<ec_cpp::PolyEncoder_f2e16> files(encoder,
+                                                                 1ull << 16);
+
+        std::vector<std::string> paths(n);
+        for (size_t i = 0ull; i < n; ++i)
+          paths[i] = dir / ("shard_" + std::to_string(i));
+        ASSERT_TRUE(ec_cpp::resultGetValue(
+            files.encodeFile(dir / "payload", paths)));
+
+        const auto shards = ec_cpp::resultGetValue(
+            encoder.encode({payload.data(), payload.size()}));
+        for (size_t i = 0ull; i < n; ++i)
+          ASSERT_EQ(ec_cpp::test::readFile(paths[i]), shards[i]);
+
+        // from the systematic shards, then with every third shard erased
+        // and one file missing
+        for (size_t pass = 0ull; pass < 2ull; ++pass) {
+          auto received = paths;
+          if (pass == 1ull) {
+            for (size_t i = 0ull; i < n; i += 3ull)
+              received[i].clear();
+            fs::remove(received[1]);
+          }
+          ASSERT_TRUE(ec_cpp::resultGetValue(files.reconstructFile(
+              received, dir / "output", payload.size())));
+          ASSERT_EQ(ec_cpp::test::readFile(dir / "output"), payload);
+        }
+
+        ASSERT_EQ(ec_cpp::resultGetError(files.reconstructFile(
+                      paths, dir / "output", shards[2].size() * n)),
+                  ec_cpp::Error::kOutputTooLong);
+      }
+
+  auto encoder = ec_cpp::resultGetValue(ec_cpp::create(6));
+  const ec_cpp::FileCodec<ec_cpp::PolyEncoder_f2e16> files(encoder);
+  ASSERT_EQ(ec_cpp::resultGetError(files.encodeFile(
+                dir / "missing", std::vector<std::string>(6, dir / "x"))),
+            ec_cpp::Error::kIoError);
+  ec_cpp::test::writeFile(dir / "empty", {});
+  ASSERT_EQ(ec_cpp::resultGetError(files.encodeFile(
+                dir / "empty", std::vector<std::string>(6, dir / "x"))),
+            ec_cpp::Error::kPayloadSizeIsZero);
+  fs::remove_all(dir);
+}
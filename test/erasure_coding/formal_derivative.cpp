@@ -0,0 +1,43 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <ec-cpp/ec-cpp.hpp>
+
+namespace {
+
+struct Odd {
+  uint8_t bytes[6];
+};
+
+template <typename T> void checkFormalDerivative() {
+  std::mt19937 rng(11);
+  for (size_t size : {0ull, 1ull, 3ull, 16ull, 64ull, 1024ull, 4096ull})
+    for (size_t capacity : {size, size + 1, size * 3, size * 4}) {
+      std::vector<T> data(std::max(capacity, size_t(1ull)));
+      auto *bytes = reinterpret_cast<uint8_t *>(data.data());
+      for (size_t i = 0; i < data.size() * sizeof(T); ++i)
+        bytes[i] = uint8_t(rng());
+
+      auto expected = data;
+      ec_cpp::formalDerivativeScalar(expected.data(), size, capacity);
+      ec_cpp::formalDerivative(data.data(), size, capacity);
+      ASSERT_EQ(memcmp(data.data(), expected.data(), data.size() * sizeof(T)),
+                0)
+          << "size = " << size << ", capacity = " << capacity;
+    }
+}
+
+} // namespace
+
+TEST(erasure_coding, Cpp_FormalDerivative) {
+  checkFormalDerivative<uint16_t>();
+  checkFormalDerivative<ec_cpp::Additive<ec_cpp::f2e16_Descriptor>>();
+  checkFormalDerivative<ec_cpp::bitsliced::Word>();
+  checkFormalDerivative<Odd>();
+}
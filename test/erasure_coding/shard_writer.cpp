@@ -0,0 +1,90 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+#include <fcntl.h>
+
+#include <ec-cpp/ec-cpp.hpp>
+
+#include "test_util.hpp"
+
+namespace fs = std::filesystem;
+
+TEST(erasure_coding, Cpp_ShardWriter) {
+  const auto dir = fs::temp_directory_path() /
+                   ("ec_cpp_shard_writer_" + std::to_string(::getpid()));
+  fs::create_directories(dir);
+  auto payload = ec_cpp::test::makePayload(3000017);
+  const ec_cpp::Slice<uint8_t> bytes{payload.data(), payload.size()};
+
+  for (const auto backend :
+       {ec_cpp::WriteBackend::kIoUring, ec_cpp::WriteBackend::kThreads}) {
+    ec_cpp::ShardWriter writer(backend);
+    for (const auto version :
+         {ec_cpp::CodeVersion::kV1, ec_cpp::CodeVersion::kV2})
+      for (size_t n : {6ull, 100ull}) {
+        auto encoder =
+            ec_cpp::resultGetValue(ec_cpp::create(n, version));
+        const auto shards = ec_cpp::resultGetValue(encoder.encode(bytes));
+
+        ec_cpp::ShardSet plain(n, encoder.shardLen(bytes.size()));
+        ASSERT_TRUE(ec_cpp::resultGetValue(encoder.encodeInto(bytes, plain)));
+        ASSERT_EQ(plain.toShards(), shards);
+
+        // two candidates in flight, each shard after a header
+        ec_cpp::ShardSet sets[2] = {
+            {n, encoder.shardLen(bytes.size())},
+            {n, encoder.shardLen(bytes.size())}};
+        std::vector<int> files[2];
+        std::future<ec_cpp::Result<bool>> done[2];
+        for (size_t s = 0ull; s < 2ull; ++s) {
+          for (size_t i = 0ull; i < n; ++i)
+            files[s].push_back(::open(
+                (dir / ("shard_" + std::to_string(s) + "_" +
+                        std::to_string(i)))
+                    .c_str(),
+                O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+          const auto candidate = writer.begin(sets[s], files[s], 7ull);
+          ASSERT_TRUE(ec_cpp::resultGetValue(encoder.encodeInto(
+              bytes, sets[s], [&](size_t first, size_t last) {
+                writer.write(candidate, first, last);
+              })));
+          done[s] = writer.finish(candidate);
+        }
+
+        for (size_t s = 0ull; s < 2ull; ++s) {
+          ASSERT_TRUE(ec_cpp::resultGetValue(done[s].get()));
+          for (size_t i = 0ull; i < n; ++i) {
+            ::close(files[s][i]);
+            const auto written = ec_cpp::test::readFile(
+                dir / ("shard_" + std::to_string(s) + "_" +
+                       std::to_string(i)));
+            ASSERT_EQ(written.size(), 7ull + shards[i].size());
+            ASSERT_TRUE(std::equal(shards[i].begin(), shards[i].end(),
+                                   written.begin() + 7));
+          }
+        }
+
+        ec_cpp::ShardSet wrong(n, 1ull);
+        ASSERT_EQ(ec_cpp::resultGetError(encoder.encodeInto(bytes, wrong)),
+                  ec_cpp::Error::kInconsistentShardLengths);
+      }
+  }
+
+  // a write to a closed file fails its candidate
+  ec_cpp::ShardWriter writer;
+  auto encoder = ec_cpp::resultGetValue(ec_cpp::create(6));
+  ec_cpp::ShardSet set(6, encoder.shardLen(bytes.size()));
+  const auto candidate = writer.begin(set, std::vector<int>(6, -1));
+  encoder.encodeInto(bytes, set, [&](size_t first, size_t last) {
+    writer.write(candidate, first, last);
+  });
+  ASSERT_EQ(ec_cpp::resultGetError(writer.finish(candidate).get()),
+            ec_cpp::Error::kIoError);
+  fs::remove_all(dir);
+}
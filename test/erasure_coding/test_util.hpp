@@ -0,0 +1,40 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NOVELPOLY_REED_SOLOMON_CRUST_TEST_UTIL_HPP
+#define NOVELPOLY_REED_SOLOMON_CRUST_TEST_UTIL_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+namespace ec_cpp::test {
+
+/// Payload bytes without a short period, so that shards or columns read
+/// from the wrong offset do not compare equal.
+inline std::vector<uint8_t> makePayload(size_t size) {
+  std::vector<uint8_t> payload(size);
+  for (size_t i = 0; i < size; ++i)
+    payload[i] = uint8_t(i * 31 + 7 + i / 251);
+  return payload;
+}
+
+inline std::vector<uint8_t> readFile(const std::filesystem::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in),
+          std::istreambuf_iterator<char>()};
+}
+
+inline void writeFile(const std::filesystem::path &path,
+                      const std::vector<uint8_t> &data) {
+  std::ofstream out(path, std::ios::binary);
+  out.write(reinterpret_cast<const char *>(data.data()), data.size());
+}
+
+} // namespace ec_cpp::test
+
+#endif // NOVELPOLY_REED_SOLOMON_CRUST_TEST_UTIL_HPP
@@ -0,0 +1,43 @@
+/**
+ * Copyright Soramitsu Co., Ltd. All Rights Reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <ec-cpp/ec-cpp.hpp>
+
+TEST(erasure_coding, Cpp_WalshKernels) {
+  using Descriptor = ec_cpp::f2e16_Descriptor;
+  using Logs = std::array<uint16_t, Descriptor::kFieldSize>;
+  std::mt19937 rng(7);
+
+  for (size_t round = 0; round < 6; ++round) {
+    Logs logs;
+    for (auto &x : logs)
+      // Erasure indicators as in the error polynomial, and full range logs
+      // with the unreduced 65535 among them.
+      x = round % 2 == 0 ? uint16_t(rng() % 2)
+                         : (rng() % 8 == 0 ? uint16_t(65535) : uint16_t(rng()));
+
+    auto expected = logs;
+    ec_cpp::walshScalar<Descriptor>(expected);
+
+    auto dispatched = logs;
+    ec_cpp::walsh<Descriptor>(dispatched);
+    ASSERT_EQ(dispatched, expected);
+
+    if (ec_cpp::cpu::hasAvx2()) {
+      auto avx2 = logs;
+      ec_cpp::detail::walshAvx2(avx2.data(), avx2.size());
+      ASSERT_EQ(avx2, expected);
+    }
+    if (ec_cpp::cpu::hasAvx512bw()) {
+      auto avx512 = logs;
+      ec_cpp::detail::walshAvx512(avx512.data(), avx512.size());
+      ASSERT_EQ(avx512, expected);
+    }
+  }
+}